@@ -0,0 +1,268 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "timer_internal.h"
+
+/* Running mean and sum of squared deviations (Welford) of one side */
+typedef struct
+{
+    int64_t count;
+    double mean;
+    double m2;
+} ab_moments_t;
+
+/** Functions **/
+
+/* Function
+ *  internal function that adds a duration to the running moments
+ */
+static inline
+void ab_add(ab_moments_t * m, int64_t value)
+{
+    double delta = (double) value - m->mean;
+    m->count++;
+    m->mean += delta / m->count;
+    m->m2 += delta * ((double) value - m->mean);
+}
+
+/* Function
+ *  internal function evaluating the continued fraction of the incomplete
+ *  beta function (modified Lentz's method)
+ */
+static
+double beta_cf(double a, double b, double x)
+{
+    const double tiny = 1e-300;
+    double c = 1.0, d = 1.0 - (a + b) * x / (a + 1.0), h;
+
+    if(fabs(d) < tiny) d = tiny;
+    d = 1.0 / d;
+    h = d;
+    for(int m = 1; m <= 300; m++)
+    {
+        double aa = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+        d = 1.0 + aa * d;
+        if(fabs(d) < tiny) d = tiny;
+        c = 1.0 + aa / c;
+        if(fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        h *= d * c;
+
+        aa = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+        d = 1.0 + aa * d;
+        if(fabs(d) < tiny) d = tiny;
+        c = 1.0 + aa / c;
+        if(fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        double step = d * c;
+        h *= step;
+        if(fabs(step - 1.0) < 1e-12) break;
+    }
+    return h;
+}
+
+/* Function
+ *  internal function computing the regularised incomplete beta function
+ *  I_x(a, b)
+ */
+static
+double beta_inc(double a, double b, double x)
+{
+    double front;
+
+    if(x <= 0.0) return 0.0;
+    if(x >= 1.0) return 1.0;
+    front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x));
+    if(x < (a + 1.0) / (a + b + 2.0)) return front * beta_cf(a, b, x) / a;
+    return 1.0 - front * beta_cf(b, a, 1.0 - x) / b;
+}
+
+/* Function
+ *  internal function that fills in Welch's t-test of the two sides
+ */
+static
+void ab_compare(ab_moments_t * a, ab_moments_t * b, ctimer_ab_result_t * res)
+{
+    double va, vb, se;
+
+    res->mean_a = a->mean;
+    res->mean_b = b->mean;
+    res->diff = a->mean > 0.0 ? (b->mean - a->mean) / a->mean : 0.0;
+    res->sd_a = res->sd_b = 0.0;
+    res->t = res->df = 0.0;
+    res->p = 1.0;
+    if(a->count < 2 || b->count < 2) return;
+
+    va = a->m2 / (a->count - 1);
+    vb = b->m2 / (b->count - 1);
+    res->sd_a = sqrt(va);
+    res->sd_b = sqrt(vb);
+    va /= a->count;
+    vb /= b->count;
+    se = sqrt(va + vb);
+    if(se == 0.0)
+    {
+        res->p = a->mean == b->mean ? 1.0 : 0.0;
+        return;
+    }
+
+    res->t = (b->mean - a->mean) / se;
+    res->df = (va + vb) * (va + vb) /
+        (va * va / (a->count - 1) + vb * vb / (b->count - 1));
+    res->p = beta_inc(res->df / 2.0, 0.5, res->df / (res->df + res->t * res->t));
+}
+
+/* Function
+ *  compare two implementations by measuring them interleaved: every round
+ *  runs A and B once each, in a random order, so that frequency and
+ *  thermal drift or noisy neighbours affect both sides alike. Each side is
+ *  timed with its own interval and the means are compared with Welch's
+ *  t-test.
+ *
+ *  @param cfg: the comparison configuration
+ *  @param fn_a, arg_a: implementation A and its argument
+ *  @param fn_b, arg_b: implementation B and its argument
+ *  @param res: the results, histograms that are NULL get allocated
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_ab_run(ctimer_ab_t * cfg, ctimer_ab_fn fn_a, void * arg_a, ctimer_ab_fn fn_b, void * arg_b,
+                  ctimer_ab_result_t * res)
+{
+    ctimer_interval_t * iv[2] = {NULL, NULL};
+    ctimer_ab_fn fn[2] = {fn_a, fn_b};
+    void * arg[2] = {arg_a, arg_b};
+    ab_moments_t moments[2];
+    ctimer_hist_t * hist[2];
+    unsigned int seed;
+    int ret = CTIMER_CLOCK_FAILED;
+
+    CHECK(!cfg || !fn_a || !fn_b || !res, "Invalid A/B comparison arguments!");
+    CHECK(cfg->rounds <= 0 || cfg->warmup < 0, "Invalid number of rounds %lld",
+          (long long) cfg->rounds);
+
+    ret = CTIMER_NOT_ALLOCATED;
+    if(!res->a && ctimer_create_hist(&res->a) != CTIMER_OK) goto error;
+    if(!res->b && ctimer_create_hist(&res->b) != CTIMER_OK) goto error;
+    if(ctimer_create_interval(&iv[0], "A", cfg->clock, CTIMER_NS) != CTIMER_OK) goto error;
+    if(ctimer_create_interval(&iv[1], "B", cfg->clock, CTIMER_NS) != CTIMER_OK) goto error;
+    ctimer_hist_reset(res->a);
+    ctimer_hist_reset(res->b);
+    hist[0] = res->a;
+    hist[1] = res->b;
+    memset(moments, 0, sizeof(moments));
+    res->errors = 0;
+
+    seed = cfg->seed;
+    for(int64_t r = -cfg->warmup; r < cfg->rounds; r++)
+    {
+        int first = rand_r(&seed) & 1;
+        for(int i = 0; i < 2; i++)
+        {
+            int side = first ^ i;
+            ctimer_start(iv[side]);
+            if(fn[side](arg[side]) != CTIMER_OK && r >= 0) res->errors++;
+            ctimer_stop(iv[side]);
+            if(r < 0) continue;
+
+            int64_t ns = ctimer_elapsed_interval_ns(iv[side]);
+            ctimer_hist_record(hist[side], ns);
+            ab_add(&moments[side], ns);
+        }
+    }
+    ab_compare(&moments[0], &moments[1], res);
+    ret = CTIMER_OK;
+
+error:
+    free(iv[0]);
+    free(iv[1]);
+    return ret;
+}
+
+/* Function
+ *  run a benchmark binary to completion, its standard output is discarded
+ *
+ *  @param argv: NULL terminated argument vector, argv[0] is looked up in
+ *               the PATH
+ *
+ *  @return: either OK, or CTIMER_CALL_FAILED if it did not exit with 0
+ */
+int ctimer_ab_exec(char * const * argv)
+{
+    posix_spawn_file_actions_t actions;
+    pid_t pid, done;
+    int status, ret;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    ret = posix_spawnp(&pid, argv[0], &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    CHECK(ret, "Unable to run %s: %s", argv[0], strerror(ret));
+    do {
+        done = waitpid(pid, &status, 0);
+    } while(done < 0 && errno == EINTR);
+    CHECK(done != pid, "Unable to wait for %s", argv[0]);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? CTIMER_OK : CTIMER_CALL_FAILED;
+
+error:
+    return CTIMER_CALL_FAILED;
+}
+
+/* Function
+ *  internal implementation for ctimer_ab_run_exec()
+ */
+static
+int ab_exec(void * arg)
+{
+    return ctimer_ab_exec((char * const *) arg);
+}
+
+/* Function
+ *  compare two benchmark binaries with ctimer_ab_run(), each round runs
+ *  both to completion with ctimer_ab_exec()
+ *
+ *  @param cfg: the comparison configuration
+ *  @param argv_a, argv_b: NULL terminated argument vectors of A and B
+ *  @param res: the results, histograms that are NULL get allocated
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_ab_run_exec(ctimer_ab_t * cfg, char * const * argv_a, char * const * argv_b,
+                       ctimer_ab_result_t * res)
+{
+    return ctimer_ab_run(cfg, ab_exec, (void *) argv_a, ab_exec, (void *) argv_b, res);
+}
+
+/* Function
+ *  print the results of an A/B comparison
+ *
+ *  @param res: the results
+ *  @param name_a, name_b: names of the two implementations
+ *  @param ut: unit enum of the printed durations
+ */
+void ctimer_print_ab(ctimer_ab_result_t * res, char * name_a, char * name_b, ctimer_unit_e ut)
+{
+    char * unit = ctimer_print_unit(ut);
+
+    ctimer_print_hist(res->a, name_a, ut);
+    ctimer_print_hist(res->b, name_b, ut);
+    printf("%s vs %s: mean %.3f +- %.3f %s vs %.3f +- %.3f %s", name_b, name_a,
+           ctimer_ns_to_unit((int64_t) res->mean_b, ut), ctimer_ns_to_unit((int64_t) res->sd_b, ut), unit,
+           ctimer_ns_to_unit((int64_t) res->mean_a, ut), ctimer_ns_to_unit((int64_t) res->sd_a, ut), unit);
+    printf(", %+.2f%%, t %.2f, df %.1f, p %.3g, %lld errors\n", 100.0 * res->diff, res->t, res->df,
+           res->p, (long long) res->errors);
+    if(res->p < CTIMER_AB_ALPHA)
+        printf("%s is %s than %s (significant at %g)\n", name_b,
+               res->diff > 0.0 ? "slower" : "faster", name_a, CTIMER_AB_ALPHA);
+    else
+        printf("%s and %s do not differ significantly (at %g)\n", name_b, name_a, CTIMER_AB_ALPHA);
+}
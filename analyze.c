@@ -0,0 +1,321 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "timer_internal.h"
+
+/* Blocks a worker takes at a time */
+#define CHUNK 16
+
+/* State shared by the workers of an analysis */
+typedef struct
+{
+    ctimer_trace_file_t * file;
+    ctimer_analysis_t * res;
+    int64_t next;
+    int top;
+} analyze_job_t;
+
+/* Partial results of one worker, merged when all are done */
+typedef struct
+{
+    analyze_job_t * job;
+    ctimer_hist_t * hists[CTIMER_TRACE_NAMES];
+    int64_t * count;
+    int64_t * total;
+    ctimer_sample_t top[CTIMER_ANALYZE_TOP];
+    int ntop;
+    int64_t samples;
+    int64_t errors;
+} analyze_worker_t;
+
+/** Functions **/
+
+static inline int64_t length(const ctimer_sample_t * s) { return s->stop - s->start; }
+
+/* Function
+ *  internal function keeping the slowest samples in a min-heap of at most
+ *  max entries, the fastest kept sample at the root
+ */
+static
+void top_push(ctimer_sample_t * heap, int * n, int max, const ctimer_sample_t * s)
+{
+    int i;
+
+    if(*n < max) i = (*n)++;
+    else if(length(s) > length(&heap[0]))
+    {
+        /* Replace the root and sift it down */
+        i = 0;
+        for(;;)
+        {
+            int c = 2 * i + 1;
+            if(c >= *n) break;
+            if(c + 1 < *n && length(&heap[c + 1]) < length(&heap[c])) c++;
+            if(length(&heap[c]) >= length(s)) break;
+            heap[i] = heap[c];
+            i = c;
+        }
+        heap[i] = *s;
+        return;
+    }
+    else return;
+
+    /* Sift the new entry up */
+    while(i > 0 && length(&heap[(i - 1) / 2]) > length(s))
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = *s;
+}
+
+static int slower(const void * a, const void * b)
+{
+    int64_t x = length((const ctimer_sample_t *) a), y = length((const ctimer_sample_t *) b);
+    return (x < y) - (x > y);
+}
+
+static int thread_cmp(const void * a, const void * b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* Function
+ *  internal function returning the index of a thread id in the sorted ids
+ */
+static
+int thread_index(ctimer_analysis_t * a, uint32_t thread)
+{
+    uint32_t * found = (uint32_t *) bsearch(&thread, a->threads, a->nthreads, sizeof(uint32_t), thread_cmp);
+    return found ? (int) (found - a->threads) : 0;
+}
+
+/* Function
+ *  internal worker thread, takes chunks of blocks until none are left
+ */
+static
+void * analyze_worker(void * arg)
+{
+    analyze_worker_t * w = (analyze_worker_t *) arg;
+    analyze_job_t * job = w->job;
+    ctimer_analysis_t * a = job->res;
+    ctimer_decoder_t dec;
+    ctimer_sample_t s;
+    int64_t first;
+    int ret;
+
+    while((first = __atomic_fetch_add(&job->next, CHUNK, __ATOMIC_RELAXED)) < job->file->nblocks)
+    {
+        int64_t last = first + CHUNK < job->file->nblocks ? first + CHUNK : job->file->nblocks;
+        for(int64_t b = first; b < last; b++)
+        {
+            ctimer_decode_block(&dec, job->file, b);
+            int thread = thread_index(a, dec.thread);
+            int64_t * count = &w->count[thread];
+            int64_t * total = &w->total[thread];
+
+            while((ret = ctimer_decode_next(&dec, &s)) > 0)
+            {
+                if(s.name >= (uint32_t) a->nnames)
+                {
+                    ret = CTIMER_CALL_FAILED;
+                    break;
+                }
+                if(!w->hists[s.name] && ctimer_create_hist(&w->hists[s.name]) != CTIMER_OK)
+                {
+                    ret = CTIMER_NOT_ALLOCATED;
+                    break;
+                }
+                ctimer_hist_record(w->hists[s.name], length(&s));
+                count[(size_t) s.name * a->nthreads]++;
+                total[(size_t) s.name * a->nthreads] += length(&s);
+                if(job->top) top_push(w->top, &w->ntop, job->top, &s);
+                w->samples++;
+            }
+            if(ret < 0) w->errors++;
+        }
+    }
+    return NULL;
+}
+
+/* Function
+ *  compute per-name statistics of a trace file: a histogram of the sample
+ *  lengths, the count and total per thread, and the slowest samples. The
+ *  blocks are shared out in chunks to worker threads, each of which keeps
+ *  partial results that are merged at the end. Release the analysis with
+ *  ctimer_free_analysis(), it uses the names of the file, so close the file
+ *  afterwards.
+ *
+ *  @param tmp: the address of the analysis to be allocated
+ *  @param f: the trace file
+ *  @param workers: number of threads, 0 for one per online CPU
+ *  @param top: number of slowest samples to keep, up to CTIMER_ANALYZE_TOP
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_analyze_trace_file(ctimer_analysis_t ** tmp, ctimer_trace_file_t * f, int workers, int top)
+{
+    ctimer_analysis_t * a;
+    analyze_job_t job = {f, NULL, 0, top};
+    analyze_worker_t * w = NULL;
+    pthread_t * ids = NULL;
+    size_t cells;
+    int started = 0, ret = CTIMER_NOT_ALLOCATED;
+
+    *tmp = NULL;
+    CHECK(top < 0 || top > CTIMER_ANALYZE_TOP, "Invalid number of slowest samples %d", top);
+    if(workers <= 0) workers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if(workers > CTIMER_MAX_THREADS) workers = CTIMER_MAX_THREADS;
+    if(workers > (f->nblocks + CHUNK - 1) / CHUNK) workers = (int) ((f->nblocks + CHUNK - 1) / CHUNK);
+    if(workers < 1) workers = 1;
+
+    *tmp = job.res = a = (ctimer_analysis_t *) calloc(1, sizeof(ctimer_analysis_t));
+    CHECK(!a, "Unable to create analysis!");
+    a->nnames = f->nnames;
+    memcpy(a->names, f->names, sizeof(a->names));
+    a->epoch = f->epoch;
+
+    /* Distinct thread ids, from the block headers only, which follow
+     * variable-length data and may be misaligned */
+    a->threads = (uint32_t *) malloc((f->nblocks ? f->nblocks : 1) * sizeof(uint32_t));
+    CHECK(!a->threads, "Unable to allocate thread ids!");
+    for(int64_t b = 0; b < f->nblocks; b++)
+    {
+        ctimer_block_t head;
+        memcpy(&head, f->data + f->blocks[b], sizeof(head));
+        a->threads[b] = head.thread;
+    }
+    qsort(a->threads, f->nblocks, sizeof(uint32_t), thread_cmp);
+    for(int64_t b = 0; b < f->nblocks; b++)
+        if(b == 0 || a->threads[b] != a->threads[a->nthreads - 1]) a->threads[a->nthreads++] = a->threads[b];
+
+    cells = (size_t) (a->nnames ? a->nnames : 1) * (a->nthreads ? a->nthreads : 1);
+    a->count = (int64_t *) calloc(cells, sizeof(int64_t));
+    a->total = (int64_t *) calloc(cells, sizeof(int64_t));
+    w = (analyze_worker_t *) calloc(workers, sizeof(analyze_worker_t));
+    ids = (pthread_t *) malloc(workers * sizeof(pthread_t));
+    CHECK(!a->count || !a->total || !w || !ids, "Unable to allocate analysis results!");
+
+    for(int i = 0; i < workers; i++)
+    {
+        w[i].job = &job;
+        w[i].count = (int64_t *) calloc(cells, sizeof(int64_t));
+        w[i].total = (int64_t *) calloc(cells, sizeof(int64_t));
+        CHECK(!w[i].count || !w[i].total, "Unable to allocate analysis results!");
+    }
+    for(started = 0; started < workers; started++)
+        if(pthread_create(&ids[started], NULL, analyze_worker, &w[started])) break;
+
+    /* The started workers take over the blocks of the missing ones */
+    if(started < workers)
+    {
+        DEBUG("Analysing with %d of %d threads", started, workers);
+    }
+    if(!started) analyze_worker(&w[0]);
+    for(int i = 0; i < started; i++)
+        pthread_join(ids[i], NULL);
+
+    /* Merge the partial results */
+    for(int i = 0; i < workers; i++)
+    {
+        for(int n = 0; n < a->nnames; n++)
+        {
+            if(!w[i].hists[n]) continue;
+            if(!a->hists[n])
+            {
+                a->hists[n] = w[i].hists[n];
+                w[i].hists[n] = NULL;
+            }
+            else ctimer_hist_merge(a->hists[n], w[i].hists[n]);
+        }
+        for(size_t c = 0; c < cells; c++)
+        {
+            a->count[c] += w[i].count[c];
+            a->total[c] += w[i].total[c];
+        }
+        for(int t = 0; t < w[i].ntop; t++)
+            top_push(a->top, &a->ntop, top, &w[i].top[t]);
+        a->samples += w[i].samples;
+        a->errors += w[i].errors;
+    }
+    qsort(a->top, a->ntop, sizeof(ctimer_sample_t), slower);
+    ret = CTIMER_OK;
+
+error:
+    for(int i = 0; w && i < workers; i++)
+    {
+        for(int n = 0; n < CTIMER_TRACE_NAMES; n++)
+            free(w[i].hists[n]);
+        free(w[i].count);
+        free(w[i].total);
+    }
+    free(w);
+    free(ids);
+    if(ret != CTIMER_OK && *tmp)
+    {
+        ctimer_free_analysis(*tmp);
+        *tmp = NULL;
+    }
+    return ret;
+}
+
+/* Function
+ *  release an analysis
+ *
+ *  @param a: the analysis
+ */
+void ctimer_free_analysis(ctimer_analysis_t * a)
+{
+    for(int n = 0; n < CTIMER_TRACE_NAMES; n++)
+        free(a->hists[n]);
+    free(a->threads);
+    free(a->count);
+    free(a->total);
+    free(a);
+}
+
+/* Function
+ *  print an analysis: the length statistics and the per-thread breakdown
+ *  of every name, then the slowest samples with their start times in UTC
+ *
+ *  @param a: the analysis
+ *  @param ut: unit enum of the printed lengths
+ */
+void ctimer_print_analysis(ctimer_analysis_t * a, ctimer_unit_e ut)
+{
+    char * unit = ctimer_print_unit(ut);
+
+    printf("Analysis: %lld samples of %d names from %d threads, %lld broken blocks\n",
+           (long long) a->samples, a->nnames, a->nthreads, (long long) a->errors);
+    for(int n = 0; n < a->nnames; n++)
+    {
+        if(!a->hists[n]) continue;
+        ctimer_print_hist(a->hists[n], a->names[n], ut);
+        printf("  total %.3f %s\n", ctimer_ns_to_unit(a->hists[n]->total, ut), unit);
+        for(int i = 0; i < a->nthreads; i++)
+        {
+            size_t c = (size_t) n * a->nthreads + i;
+            if(!a->count[c]) continue;
+            printf("  thread %u: count %lld, total %.3f %s, mean %.3f %s\n", a->threads[i],
+                   (long long) a->count[c], ctimer_ns_to_unit(a->total[c], ut), unit,
+                   ctimer_ns_to_unit(a->total[c] / a->count[c], ut), unit);
+        }
+    }
+    for(int t = 0; t < a->ntop; t++)
+    {
+        char at[64];
+
+        /* Files before version 3 have no wall time, their starts stay raw */
+        if(!a->epoch.count ||
+           ctimer_format_utc(ctimer_epoch_to_realtime(&a->epoch, a->top[t].start), at, sizeof(at)))
+            snprintf(at, sizeof(at), "%lld", (long long) a->top[t].start);
+        printf("Slowest #%d: %s on thread %u, cpu %u: %.3f %s at %s\n", t + 1,
+               a->top[t].name < (uint32_t) a->nnames ? a->names[a->top[t].name] : "?",
+               a->top[t].thread, a->top[t].cpu, ctimer_ns_to_unit(length(&a->top[t]), ut), unit, at);
+    }
+}
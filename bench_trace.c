@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "ctimer.h"
+
+#ifndef SAMPLES
+#define SAMPLES (1 << 20)
+#endif
+
+#ifndef THREADS
+#define THREADS 4
+#endif
+
+#define ROUNDS 3
+
+/* Fills the buffer of one thread, the first sample creates the buffer and
+ * is not timed; the result is the time per sample in nano-seconds */
+static void * recorder(void * arg)
+{
+    ctimer_trace_t * t = (ctimer_trace_t *) arg;
+    ctimer_interval_t * iv;
+    double * cost = (double *) malloc(sizeof(double));
+
+    ctimer_create_interval(&iv, "record", CTIMER_MONO, CTIMER_NS);
+    ctimer_trace_record(t, 0, 0, 0);
+    ctimer_start(iv);
+    for(int64_t i = 1; i < SAMPLES; i++)
+        ctimer_trace_record(t, (int) (i & 1), i, 2 * i);
+    ctimer_stop(iv);
+    *cost = (double) ctimer_elapsed_interval_ns(iv) / (SAMPLES - 1);
+    free(iv);
+    return cost;
+}
+
+/* Records with all threads into a new trace, returns the mean cost of a
+ * sample over the threads */
+static double measure(int flags, int * huge)
+{
+    ctimer_trace_t * t;
+    pthread_t ids[THREADS];
+    double sum = 0.0;
+
+    if(ctimer_create_trace(&t, CTIMER_MONO, SAMPLES, flags) != CTIMER_OK) return 0.0;
+    ctimer_trace_name(t, "even");
+    ctimer_trace_name(t, "odd");
+    for(int i = 0; i < THREADS; i++)
+        pthread_create(&ids[i], NULL, recorder, t);
+    for(int i = 0; i < THREADS; i++)
+    {
+        double * cost;
+        pthread_join(ids[i], (void **) &cost);
+        sum += *cost;
+        free(cost);
+    }
+    *huge = 0;
+    for(ctimer_tbuf_t * buf = t->buffers; buf; buf = buf->next)
+        *huge += buf->pages != CTIMER_PAGES_NORMAL;
+    ctimer_free_trace(t);
+    return sum / THREADS;
+}
+
+int main()
+{
+    char * names[] = {"normal", "huge"};
+    double best[2] = {0.0, 0.0};
+    int huge[2] = {0, 0};
+
+    for(int r = 0; r < ROUNDS; r++)
+        for(int m = 0; m < 2; m++)
+        {
+            double cost = measure(m ? CTIMER_TRACE_HUGE : 0, &huge[m]);
+            if(best[m] == 0.0 || cost < best[m]) best[m] = cost;
+        }
+
+    printf("# pages, buffers on huge pages, ns/sample, Msamples/s per thread\n");
+    for(int m = 0; m < 2; m++)
+        printf("%s, %d/%d, %.2f, %.1f\n", names[m], huge[m], THREADS, best[m],
+               best[m] > 0.0 ? 1e3 / best[m] : 0.0);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "ctimer.h"
+
+#ifndef CALLS
+#define CALLS 10000000
+#endif
+
+/* Measure the cost of one get_time() call on the given clock */
+static double measure(ctimer_clock_e ck)
+{
+    ctimer_interval_t * iv;
+    struct timespec time;
+    clockid_t clock = ctimer_set_clock(ck);
+    double cost;
+
+    ctimer_create_interval(&iv, "get_time", CTIMER_MONOR, CTIMER_NS);
+    ctimer_start(iv);
+    for(long i = 0; i < CALLS; i++)
+        ctimer_get_time(clock, &time);
+    ctimer_stop(iv);
+    cost = ctimer_ns_to_unit(ctimer_elapsed_interval_ns(iv), CTIMER_NS) / CALLS;
+    free(iv);
+    return cost;
+}
+
+int main()
+{
+    ctimer_clock_e clocks[] = {CTIMER_MONO, CTIMER_MONOC, CTIMER_RTC};
+    char * names[] = {"mono", "monoc", "rtc"};
+    double costs[2][3];
+
+    for(int b = 0; b < 2; b++)
+    {
+        if(ctimer_set_backend(b ? CTIMER_VDSO : CTIMER_LIBC) != CTIMER_OK) return EXIT_FAILURE;
+        for(int c = 0; c < 3; c++)
+        {
+            measure(clocks[c]); /* warm-up */
+            costs[b][c] = measure(clocks[c]);
+        }
+    }
+    ctimer_set_backend(CTIMER_LIBC);
+
+    printf("# clock, libc (ns/call), vdso (ns/call)\n");
+    for(int c = 0; c < 3; c++)
+        printf("%s, %.2f, %.2f\n", names[c], costs[0][c], costs[1][c]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "timer_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* Cache line size assumed when touching and flushing memory */
+#define LINE 64
+
+/** Functions **/
+
+/* Function
+ *  internal function returning the size of the eviction buffer, twice the
+ *  last level cache if that is known
+ */
+static
+int64_t evict_size(void)
+{
+    long size = 0;
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if(size <= 0) size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    return size > 0 ? 2 * (int64_t) size : CTIMER_EVICT_BYTES;
+}
+
+/* Function
+ *  internal function that writes one byte of every line of a buffer, which
+ *  replaces the previous contents of the caches
+ */
+static
+void touch_lines(volatile char * buf, int64_t len, int64_t stride)
+{
+    for(int64_t i = 0; i < len; i += stride)
+        buf[i]++;
+}
+
+/* Function
+ *  flush a memory region from all cache levels, e.g. the data structures
+ *  a call is going to use. On architectures without a flush instruction
+ *  this does nothing.
+ *
+ *  @param addr: start of the region
+ *  @param len: length of the region in bytes
+ */
+void ctimer_flush_region(void * addr, size_t len)
+{
+    char * p = (char *) ((uintptr_t) addr & ~(uintptr_t) (LINE - 1));
+    char * end = (char *) addr + len;
+
+#if defined(__x86_64__) || defined(__i386__)
+    for(; p < end; p += LINE)
+        _mm_clflush(p);
+    _mm_mfence();
+#elif defined(__aarch64__)
+    for(; p < end; p += LINE)
+        __asm__ __volatile__("dc civac, %0" : : "r" (p) : "memory");
+    __asm__ __volatile__("dsb ish" : : : "memory");
+#else
+    (void) p;
+    (void) end;
+    DEBUG("No cache flush instruction on this architecture");
+#endif
+}
+
+/* Function
+ *  measure a call with cold and with warm caches. Before every cold run the
+ *  caches are evicted as selected by the flags, which is not timed; the
+ *  call is then repeated at once for the warm run.
+ *
+ *  @param cfg: the measurement configuration
+ *  @param fn: the call under test
+ *  @param arg: passed to every call
+ *  @param res: the results, histograms that are NULL get allocated
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_cold_run(ctimer_cold_t * cfg, ctimer_cold_fn fn, void * arg, ctimer_cold_result_t * res)
+{
+    ctimer_interval_t * iv = NULL;
+    char * evict = NULL;
+    char * pages = MAP_FAILED;
+    int64_t evict_len = 0, pages_len = 0;
+    long page = sysconf(_SC_PAGESIZE);
+    int ret = CTIMER_CLOCK_FAILED;
+
+    CHECK(!cfg || !fn || !res, "Invalid cold-start arguments!");
+    CHECK(cfg->iterations <= 0, "Invalid number of iterations %lld", (long long) cfg->iterations);
+    CHECK((cfg->flags & CTIMER_COLD_FLUSH) && cfg->nregions > 0 && !cfg->regions,
+          "No regions to flush given!");
+
+    ret = CTIMER_NOT_ALLOCATED;
+    if(!res->cold && ctimer_create_hist(&res->cold) != CTIMER_OK) goto error;
+    if(!res->warm && ctimer_create_hist(&res->warm) != CTIMER_OK) goto error;
+    if(ctimer_create_interval(&iv, "cold", cfg->clock, CTIMER_NS) != CTIMER_OK) goto error;
+    if(cfg->flags & CTIMER_COLD_EVICT)
+    {
+        evict_len = cfg->evict_bytes > 0 ? cfg->evict_bytes : evict_size();
+        evict = (char *) calloc(evict_len, 1);
+        CHECK(!evict, "Unable to allocate %lld bytes to evict the caches", (long long) evict_len);
+    }
+    if(cfg->flags & CTIMER_COLD_TLB)
+    {
+        pages_len = (int64_t) CTIMER_EVICT_PAGES * page;
+        pages = (char *) mmap(NULL, pages_len, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        CHECK(pages == MAP_FAILED, "Unable to map %d pages to evict the TLB", CTIMER_EVICT_PAGES);
+    }
+    ctimer_hist_reset(res->cold);
+    ctimer_hist_reset(res->warm);
+    res->errors = 0;
+
+    for(int64_t i = 0; i < cfg->iterations; i++)
+    {
+        if(evict) touch_lines(evict, evict_len, LINE);
+        if(pages != MAP_FAILED) touch_lines(pages + (i * LINE) % page, pages_len - page, page);
+        if(cfg->flags & CTIMER_COLD_FLUSH)
+            for(int r = 0; r < cfg->nregions; r++)
+                ctimer_flush_region(cfg->regions[r].addr, cfg->regions[r].len);
+
+        ctimer_start(iv);
+        if(fn(arg) != CTIMER_OK) res->errors++;
+        ctimer_stop(iv);
+        ctimer_hist_record(res->cold, ctimer_elapsed_interval_ns(iv));
+
+        ctimer_start(iv);
+        if(fn(arg) != CTIMER_OK) res->errors++;
+        ctimer_stop(iv);
+        ctimer_hist_record(res->warm, ctimer_elapsed_interval_ns(iv));
+    }
+    ret = CTIMER_OK;
+
+error:
+    if(pages != MAP_FAILED) munmap(pages, pages_len);
+    free(evict);
+    free(iv);
+    return ret;
+}
+
+/* Function
+ *  print the cold and warm timings of a call
+ *
+ *  @param res: the results
+ *  @param name: printed in front of the timings
+ *  @param ut: unit enum of the printed timings
+ */
+void ctimer_print_cold(ctimer_cold_result_t * res, char * name, ctimer_unit_e ut)
+{
+    char label[256];
+    int64_t cold = ctimer_hist_percentile(res->cold, 50.0);
+    int64_t warm = ctimer_hist_percentile(res->warm, 50.0);
+
+    snprintf(label, sizeof(label), "%s (cold)", name);
+    ctimer_print_hist(res->cold, label, ut);
+    snprintf(label, sizeof(label), "%s (warm)", name);
+    ctimer_print_hist(res->warm, label, ut);
+    printf("%s: cold p50 is %.2fx warm p50, %lld errors\n", name,
+           warm > 0 ? (double) cold / warm : 0.0, (long long) res->errors);
+}
@@ -0,0 +1,1128 @@
+/* ***************************************************************************
+ * This header file provides a rudimentary timing facility for C/C++ based
+ * applications
+ *
+ * Makes use of the POSIX standard derived timing mechanisms found within the
+ * C/C++ standard library. Specifically we use the `clock_gettime` function.
+ *
+ * This header file was designed for use for the accurate profiling of
+ * applications in the context of benchmarking. It was created as part of a
+ * masters project to investigate the performance portability between OpenCL
+ * and Single-Assignment C (http://www.sac-home.org/) programming models.
+ *
+ * Created by Hans-Nikolai Viessmann (C) 2015 - 2016
+ *
+ * Every public name carries the `ctimer_` (functions and types) or `CTIMER_`
+ * (constants and macros) prefix, so this header can be included next to
+ * other code without collisions. The unprefixed names of earlier versions
+ * are provided by "timer.h", which defines CTIMER_COMPAT so that the enums
+ * below also carry their short enumerators.
+ *
+ * Following macros are available to manipulate verbose output:
+ *  -   TIMERVER -> 0 (off) 1 (print errors: default) 2 (debug)
+ *
+ */
+#ifndef __CTIMER_HEADER_GUARD__
+#define __CTIMER_HEADER_GUARD__
+
+#include <stdint.h>
+#include <time.h>
+
+#if __cplusplus
+extern "C" {
+#endif
+
+#ifndef TIMERVER
+/* Verbosity level, the following values are considered valid:
+ * - 0 : verbosity off
+ * - 1 : error messages
+ * - 2 : debug
+ */
+#define TIMERVER 1
+#endif
+
+#ifndef CTIMER_TSC_CALIBRATE_MSEC
+/* Duration in milli-seconds over which the tick counter is calibrated
+ * against CLOCK_MONOTONIC_RAW. */
+#define CTIMER_TSC_CALIBRATE_MSEC 50
+#endif
+
+#ifndef CTIMER_CACHED_PERIOD_NS
+/* Default update period, in nano-seconds, of the `cached` clock */
+#define CTIMER_CACHED_PERIOD_NS 1000000
+#endif
+
+#ifndef CTIMER_EPOCH_SAMPLES
+/* Number of paired samples a ctimer_epoch_t keeps for interpolation, a
+ * multiple of 4; the older half is thinned when it fills up */
+#define CTIMER_EPOCH_SAMPLES 64
+#endif
+
+#ifndef CTIMER_HIST_PRECISION
+/* Significant bits kept per histogram bucket, values are recorded with a
+ * relative error below 2^-(CTIMER_HIST_PRECISION - 1) */
+#define CTIMER_HIST_PRECISION 7
+#endif
+
+/* Number of buckets needed to cover all non-negative int64_t values */
+#define CTIMER_HIST_BUCKETS ((1 << CTIMER_HIST_PRECISION) + \
+                             (64 - CTIMER_HIST_PRECISION) * (1 << (CTIMER_HIST_PRECISION - 1)))
+
+#ifndef CTIMER_WAIT_SPIN_NS
+/* Default time before a wait target at which ctimer_wait_until() stops sleeping
+ * and starts spinning, see ctimer_set_wait_spin() */
+#define CTIMER_WAIT_SPIN_NS 100000
+#endif
+
+#ifndef CTIMER_RATE_WINDOW
+/* Number of one-second buckets a rate meter keeps, this is the longest
+ * exact window it can report */
+#define CTIMER_RATE_WINDOW 60
+#endif
+
+/* Windows, in seconds, reported by rate meters */
+#define CTIMER_RATE_WINDOWS 3
+#define CTIMER_RATE_WINDOW_SECS {1, 10, 60}
+
+#ifndef CTIMER_TSC_SKEW_LIMIT_NS
+/* Largest inter-core tick counter offset, in nano-seconds, that
+ * ctimer_tsc_check() accepts as synchronised. */
+#define CTIMER_TSC_SKEW_LIMIT_NS 1000
+#endif
+
+#ifndef CTIMER_TSC_DRIFT_LIMIT_PPM
+/* Largest drift of the tick counter against CLOCK_MONOTONIC_RAW, in parts
+ * per million, that ctimer_tsc_check() accepts. */
+#define CTIMER_TSC_DRIFT_LIMIT_PPM 20.0
+#endif
+
+#ifndef CTIMER_TSC_MAX_CPUS
+/* Maximum number of CPUs covered by a ctimer_tsc_check() report */
+#define CTIMER_TSC_MAX_CPUS 256
+#endif
+
+#ifndef CTIMER_TSC_READINGS
+/* Paired readings ctimer_tsc_check() keeps to fit the drift over time */
+#define CTIMER_TSC_READINGS 32
+#endif
+
+#ifndef CTIMER_TSC_DRIFT_MIN_NS
+/* Shortest span of readings, in nano-seconds, over which
+ * ctimer_tsc_check() judges the drift. */
+#define CTIMER_TSC_DRIFT_MIN_NS CTIMER_NSEC_PER_SEC
+#endif
+
+#ifndef CTIMER_SWEEP_POINTS
+/* Maximum number of points of a parameter sweep */
+#define CTIMER_SWEEP_POINTS 64
+#endif
+
+#ifndef CTIMER_EVICT_BYTES
+/* Size of the buffer touched to evict the caches when the size of the last
+ * level cache is unknown */
+#define CTIMER_EVICT_BYTES (64L << 20)
+#endif
+
+#ifndef CTIMER_EVICT_PAGES
+/* Number of pages touched to evict the TLB, well above the entries of a
+ * second level TLB */
+#define CTIMER_EVICT_PAGES 16384
+#endif
+
+#ifndef CTIMER_MAX_THREADS
+/* Maximum number of threads of a scalability run */
+#define CTIMER_MAX_THREADS 256
+#endif
+
+#ifndef CTIMER_TRACE_NAMES
+/* Maximum number of distinct sample names of a trace */
+#define CTIMER_TRACE_NAMES 256
+#endif
+
+#ifndef CTIMER_HUGE_PAGE_BYTES
+/* Size of the huge pages trace buffers are rounded up to with
+ * CTIMER_TRACE_HUGE */
+#define CTIMER_HUGE_PAGE_BYTES (2L << 20)
+#endif
+
+#ifndef CTIMER_TRACE_BLOCK
+/* Samples per block of a trace file, every block decodes on its own */
+#define CTIMER_TRACE_BLOCK 4096
+#endif
+
+#ifndef CTIMER_ANALYZE_TOP
+/* Maximum number of slowest samples an analysis keeps */
+#define CTIMER_ANALYZE_TOP 100
+#endif
+
+#ifndef CTIMER_PATH_SEGMENTS
+/* Maximum number of segments of a critical path */
+#define CTIMER_PATH_SEGMENTS 256
+#endif
+
+#ifndef CTIMER_SCOPE_DEPTH
+/* Maximum number of nested scopes kept per thread and slow-log entry */
+#define CTIMER_SCOPE_DEPTH 16
+#endif
+
+#ifndef CTIMER_SLOW_ENTRIES
+/* Number of slow intervals a slow-log keeps, the latest ones */
+#define CTIMER_SLOW_ENTRIES 64
+#endif
+
+#ifndef CTIMER_AB_ALPHA
+/* Significance level at which ctimer_print_ab() reports a difference */
+#define CTIMER_AB_ALPHA 0.05
+#endif
+
+/** Error related **/
+
+#define CTIMER_OK 0
+#define CTIMER_NOT_ALLOCATED -1
+#define CTIMER_CLOCK_FAILED -2
+#define CTIMER_CALL_FAILED -3
+
+/** Time conversions **/
+
+#define CTIMER_NANO_TO_SEC(time) (time / 1000000000.0)
+#define CTIMER_NANO_TO_MSEC(time) (time / 1000000.0)
+#define CTIMER_NANO_TO_MCSEC(time) (time / 1000.0)
+
+#define CTIMER_MICRO_TO_SEC(time) (time / 1000000.0)
+#define CTIMER_MICRO_TO_MSEC(time) (time / 1000.0)
+#define CTIMER_MICRO_TO_NSEC(time) (time * 1000.0)
+
+#define CTIMER_MILLI_TO_SEC(time) (time / 1000.0)
+#define CTIMER_MILLI_TO_MCSEC(time) (time * 1000.0)
+#define CTIMER_MILLI_TO_NSEC(time) (time * 1000000.0)
+
+#define CTIMER_SEC_TO_MSEC(time) (time * 1000.0)
+#define CTIMER_SEC_TO_MCSEC(time) (time * 1000000.0)
+#define CTIMER_SEC_TO_NSEC(time) (time * 1000000000.0)
+
+/** Integer time conversions **/
+
+#define CTIMER_NSEC_PER_USEC 1000LL
+#define CTIMER_NSEC_PER_MSEC 1000000LL
+#define CTIMER_NSEC_PER_SEC 1000000000LL
+
+/** Compiler barriers for micro-benchmarks **/
+
+/* Makes the compiler assume that a variable is read and may be modified at
+ * this point: its value has to be computed before and can not be assumed
+ * after, so the work producing or consuming it stays where it was written.
+ * The argument must be an lvalue, e.g. a local variable. */
+#define CTIMER_DO_NOT_OPTIMIZE(var) __asm__ __volatile__("" : "+m" (var) : : "memory")
+
+/* Makes the compiler assume that all memory is read and written at this
+ * point, so pending stores are not deferred past it. */
+#define CTIMER_CLOBBER_MEMORY() __asm__ __volatile__("" : : : "memory")
+
+/** Global types **/
+
+/* Enum of time units */
+typedef enum
+{
+    CTIMER_S,   // seconds
+    CTIMER_MS,  // milli-seconds
+    CTIMER_US,  // micro-seconds
+    CTIMER_NS,  // nano-seconds
+    CTIMER_UNIT_CHECK, // used for enum check
+    CTIMER_NONE // use the intervals unit
+#ifdef CTIMER_COMPAT
+    , s = CTIMER_S, ms = CTIMER_MS, us = CTIMER_US, ns = CTIMER_NS,
+    unit_check = CTIMER_UNIT_CHECK, none = CTIMER_NONE
+#endif
+} ctimer_unit_e;
+
+/* Enum of system clocks */
+typedef enum
+{
+    CTIMER_RT,
+ /* - CLOCK_REALTIME
+  *       System-wide clock that measures real (i.e., wall-clock) time. Setting
+  *       this clock requires appropriate privileges. This clock is affected by
+  *       discontinuous jumps in the system time (e.g., if the system
+  *       administrator manually changes the clock), and by the incremental
+  *       adjustments performed by adjtime(3) and NTP.
+  */
+    CTIMER_RTC,
+ /* - CLOCK_REALTIME_COARSE   (Linux only!)
+  *       A faster but less precise version of CLOCK_REALTIME. Use when you
+  *       need very fast, but not fine-grained timestamps.
+  */
+    CTIMER_MONO,
+ /* - CLOCK_MONOTONIC         (Linux only!)
+  *       Clock that cannot be set and represents monotonic time since some
+  *       unspecified starting point. This clock is not affected by
+  *       discontinuous jumps in the system time (e.g., if the system
+  *       administrator manually changes the clock), but is affected by the
+  *       incremental adjustments performed by adjtime(3) and NTP.
+  */
+    CTIMER_MONOC,
+ /* - CLOCK_MONOTONIC_COARSE  (Linux only!)
+  *       A faster but less precise version of CLOCK_MONOTONIC. Use when you
+  *       need very fast, but not fine-grained timestamps.
+  */
+    CTIMER_MONOR,
+ /* - CLOCK_MONOTONIC_RAW     (Linux only!)
+  *       Similar to CLOCK_MONOTONIC, but provides access to a raw
+  *       hardware-based time that is not subject to NTP adjustments or the
+  *       incremental adjustments performed by adjtime(3).
+  */
+    CTIMER_MONOB,
+ /* - CLOCK_BOOTTIME          (Linux only!)
+  *       Identical to CLOCK_MONOTONIC, except it also includes any time that
+  *       the system is suspended. This allows applications to get a
+  *       suspend-aware monotonic clock without having to deal with the
+  *       complications of CLOCK_REALTIME, which may have discontinuities if
+  *       the time is changed using settimeofday(2).
+  */
+    CTIMER_CPUP,
+ /* - CLOCK_PROCESS_CPUTIME_ID
+  *       High-resolution per-process timer from the CPU.
+  */
+    CTIMER_CPUT,
+ /* - CLOCK_THREAD_CPUTIME_ID
+  *       Thread-specific CPU-time clock.
+  */
+    CTIMER_TSC,
+ /* - Time-stamp counter      (x86 and AArch64 only!)
+  *       Reads the CPU tick counter directly (rdtsc / cntvct_el0) and
+  *       converts ticks to nanoseconds with a multiply-shift pair that is
+  *       calibrated against CLOCK_MONOTONIC_RAW. On other architectures
+  *       this falls back to CLOCK_MONOTONIC_RAW.
+  */
+    CTIMER_CACHED
+ /* - Cached timestamp
+  *       A background thread stores the time of a source clock (CLOCK_MONOTONIC
+  *       by default) every CTIMER_CACHED_PERIOD_NS, reading it is a single load.
+  *       Use for timeouts and rate limiters which need a very cheap, rough
+  *       "now". The thread is started with the first `cached` interval or
+  *       explicitly with ctimer_cached_clock_start(); CPU-time clocks can
+  *       not be its source.
+  */
+#ifdef CTIMER_COMPAT
+    , rt = CTIMER_RT, rtc = CTIMER_RTC, mono = CTIMER_MONO,
+    monoc = CTIMER_MONOC, monor = CTIMER_MONOR, monob = CTIMER_MONOB,
+    cpup = CTIMER_CPUP, cput = CTIMER_CPUT, tsc = CTIMER_TSC,
+    cached = CTIMER_CACHED
+#endif
+} ctimer_clock_e;
+
+/* Enum of clock_gettime backends */
+typedef enum
+{
+    CTIMER_LIBC,
+ /* - clock_gettime from the C library (default)
+  */
+    CTIMER_VDSO
+ /* - __vdso_clock_gettime     (Linux only!)
+  *       The kernel's vDSO implementation resolved once at ctimer_set_backend()
+  *       and called through a cached function pointer, this skips the PLT
+  *       indirection and errno handling of the libc wrapper.
+  */
+#ifdef CTIMER_COMPAT
+    , libc = CTIMER_LIBC, vdso = CTIMER_VDSO
+#endif
+} ctimer_backend_e;
+
+/* Tick counter calibration, ns = ref_ns + ((ticks - ref_ticks) * mult) >> shift
+ *  - mult, shift -> conversion factor, mult fits into 32 bits
+ *  - freq -> ticks per second
+ *  - ref_ticks, ref_ns -> paired reading taken at calibration time
+ *  - calibrated, healthy -> set with release stores once the fields above
+ *    are valid, read them with acquire loads
+ */
+typedef struct
+{
+    uint64_t mult;
+    uint32_t shift;
+    uint64_t freq;
+    uint64_t ref_ticks;
+    int64_t ref_ns;
+    int calibrated;
+    int healthy;
+} ctimer_tsc_calib_t;
+
+/* Tick counter offset of one CPU against the reference CPU, in ticks
+ *  - offset -> estimated (ticks on cpu) - (ticks on reference cpu)
+ *  - error -> half-width of the bound around offset
+ *  - consistent -> 0 if the measured bounds contradict each other, which
+ *    means the counters are not monotonic across the two CPUs
+ */
+typedef struct
+{
+    int cpu;
+    int64_t offset;
+    int64_t error;
+    int consistent;
+} ctimer_tsc_offset_t;
+
+/* Result of a ctimer_tsc_check() run
+ *  - drift_ppm -> slope of the tick counter against CLOCK_MONOTONIC_RAW,
+ *    fitted over drift_readings paired readings spanning drift_period_ns
+ *  - drift_ns -> the drift the slope amounts to over that span
+ */
+typedef struct
+{
+    int invariant;
+    int ncpus;
+    ctimer_tsc_offset_t offsets[CTIMER_TSC_MAX_CPUS];
+    int64_t max_skew_ns;
+    int64_t drift_ns;
+    int64_t drift_period_ns;
+    double drift_ppm;
+    int drift_readings;
+    int healthy;
+} ctimer_tsc_report_t;
+
+/* Datatype
+ *  rate meter counting events and bytes, safe for concurrent writers
+ *   - clock -> clock the windows are measured with
+ *   - begin -> creation time in nano-seconds
+ *   - events, bytes -> running totals
+ *   - tick -> last second (since begin) that was accounted for
+ *   - ticking -> try-lock of the thread accounting for new seconds
+ *   - snap_events, snap_bytes -> totals at the start of each second
+ *   - ewma_events, ewma_bytes -> per second rates averaged over
+ *     CTIMER_RATE_WINDOW_SECS
+ */
+typedef struct
+{
+    ctimer_clock_e clock;
+    int64_t begin;
+    int64_t events;
+    int64_t bytes;
+    int64_t tick;
+    int ticking;
+    int64_t snap_events[CTIMER_RATE_WINDOW + 1];
+    int64_t snap_bytes[CTIMER_RATE_WINDOW + 1];
+    double ewma_events[CTIMER_RATE_WINDOWS];
+    double ewma_bytes[CTIMER_RATE_WINDOWS];
+} ctimer_rate_t;
+
+/* Datatype
+ *  snapshot of a rate meter, all rates are per second
+ *   - events, bytes -> totals
+ *   - elapsed -> nano-seconds since the meter was created
+ *   - mean_* -> rates since the meter was created
+ *   - ewma_* -> exponentially weighted rates over CTIMER_RATE_WINDOW_SECS
+ *   - window_* -> exact rates over the last CTIMER_RATE_WINDOW_SECS seconds
+ */
+typedef struct
+{
+    int64_t events;
+    int64_t bytes;
+    int64_t elapsed;
+    double mean_events;
+    double mean_bytes;
+    double ewma_events[CTIMER_RATE_WINDOWS];
+    double ewma_bytes[CTIMER_RATE_WINDOWS];
+    double window_events[CTIMER_RATE_WINDOWS];
+    double window_bytes[CTIMER_RATE_WINDOWS];
+} ctimer_rate_report_t;
+
+/* Datatype
+ *  struct interval ->
+ *   - name -> string
+ *   - start -> struct timespec
+ *   - stop -> struct timespec
+ *   - rate -> optional rate meter, its totals over the elapsed time are
+ *     printed as the throughput of the interval
+ */
+typedef struct
+{
+    char * name;
+    struct timespec start;
+    struct timespec stop;
+    struct timespec elapsed;
+    clockid_t clockid;
+    ctimer_unit_e unit;
+    ctimer_clock_e clock;
+    ctimer_rate_t * rate;
+} ctimer_interval_t;
+
+/* Paired reading of a clock and CLOCK_REALTIME, in nano-seconds */
+typedef struct
+{
+    int64_t clock;
+    int64_t realtime;
+} ctimer_epoch_pair_t;
+
+/* Datatype
+ *  mapping of a clock to wall time built from paired readings
+ *   - clock -> the clock being mapped
+ *   - seq -> sequence counter, odd while a sample is being recorded
+ *   - count -> number of valid pairs
+ *   - pairs -> pairs from the oldest to the newest, the older ones thinned
+ */
+typedef struct
+{
+    ctimer_clock_e clock;
+    uint32_t seq;
+    int count;
+    ctimer_epoch_pair_t pairs[CTIMER_EPOCH_SAMPLES];
+} ctimer_epoch_t;
+
+/* Datatype
+ *  log-linear histogram of non-negative integer values (nano-seconds),
+ *  all aggregates are kept as integers
+ *   - count, total -> number and sum of recorded values
+ *   - min, max -> exact extremes
+ *   - buckets -> counts per bucket, see CTIMER_HIST_PRECISION
+ */
+typedef struct
+{
+    int64_t count;
+    int64_t total;
+    int64_t min;
+    int64_t max;
+    int64_t buckets[CTIMER_HIST_BUCKETS];
+} ctimer_hist_t;
+
+/* Datatype
+ *  overshoot statistics of the precise wait functions, per thread
+ *   - count -> number of waits
+ *   - total, max -> sum and maximum of the time returned past the target
+ *   - sleeps -> number of waits that slept before spinning
+ *   - wake_total, wake_max -> sum and maximum of the time the sleep
+ *     returned past its own deadline, the spin time should cover this
+ */
+typedef struct
+{
+    int64_t count;
+    int64_t total;
+    int64_t max;
+    int64_t sleeps;
+    int64_t wake_total;
+    int64_t wake_max;
+} ctimer_wait_stats_t;
+
+/* Datatype
+ *  histogram over a sliding time window, made of a ring of sub-histograms
+ *  that each cover one period
+ *   - clock -> clock the periods are measured with
+ *   - begin -> creation time in nano-seconds
+ *   - period -> nano-seconds covered by one sub-histogram
+ *   - slots -> number of periods in the longest window
+ *   - current -> index of the current period since begin
+ *   - rotating -> try-lock of the thread rotating the ring
+ *   - epochs -> period index held by each sub-histogram, slots + 1 entries
+ *   - hists -> the sub-histograms, slots + 1 entries, the spare one is
+ *     cleared ahead of time so recorders only wait for a rotation after
+ *     an idle gap
+ */
+typedef struct
+{
+    ctimer_clock_e clock;
+    int64_t begin;
+    int64_t period;
+    int slots;
+    int64_t current;
+    int rotating;
+    int64_t * epochs;
+    ctimer_hist_t * hists;
+} ctimer_whist_t;
+
+/* Call driven by the load generator, returns a status code */
+typedef int (*ctimer_loadgen_fn)(void * arg);
+
+/* Datatype
+ *  open-loop load generator configuration
+ *   - rate -> target calls per second
+ *   - calls -> number of calls to issue
+ *   - clock -> clock used for scheduling and measuring
+ */
+typedef struct
+{
+    double rate;
+    int64_t calls;
+    ctimer_clock_e clock;
+} ctimer_loadgen_t;
+
+/* Datatype
+ *  load generator results
+ *   - corrected -> latency measured from the intended send time
+ *   - uncorrected -> latency measured from the actual send time
+ *   - errors -> calls that returned a status other than OK
+ *   - late -> calls sent after their intended send time
+ *   - elapsed -> duration of the whole run in nano-seconds
+ */
+typedef struct
+{
+    ctimer_hist_t * corrected;
+    ctimer_hist_t * uncorrected;
+    int64_t calls;
+    int64_t errors;
+    int64_t late;
+    int64_t elapsed;
+} ctimer_loadgen_result_t;
+
+/* Implementation compared by ctimer_ab_run(), returns a status code */
+typedef int (*ctimer_ab_fn)(void * arg);
+
+/* Datatype
+ *  A/B comparison configuration
+ *   - rounds -> number of measurements of each implementation
+ *   - warmup -> unmeasured rounds run first
+ *   - clock -> clock the runs are measured with
+ *   - seed -> seed of the randomised order within each round
+ */
+typedef struct
+{
+    int64_t rounds;
+    int64_t warmup;
+    ctimer_clock_e clock;
+    unsigned int seed;
+} ctimer_ab_t;
+
+/* Datatype
+ *  A/B comparison results, durations are in nano-seconds
+ *   - a, b -> histograms of the run durations
+ *   - errors -> runs that returned a status other than OK
+ *   - mean_*, sd_* -> mean and standard deviation of the durations
+ *   - diff -> relative difference of B against A, (mean_b - mean_a) / mean_a
+ *   - t, df, p -> Welch's t statistic, its degrees of freedom and the
+ *     two-sided p-value of the means being equal
+ */
+typedef struct
+{
+    ctimer_hist_t * a;
+    ctimer_hist_t * b;
+    int64_t errors;
+    double mean_a;
+    double mean_b;
+    double sd_a;
+    double sd_b;
+    double diff;
+    double t;
+    double df;
+    double p;
+} ctimer_ab_result_t;
+
+/* Call measured by ctimer_cold_run(), returns a status code */
+typedef int (*ctimer_cold_fn)(void * arg);
+
+/* Flags of what ctimer_cold_run() evicts before each cold run */
+#define CTIMER_COLD_EVICT 1   // touch a buffer larger than the last level cache
+#define CTIMER_COLD_FLUSH 2   // flush the given regions from all caches
+#define CTIMER_COLD_TLB 4     // touch one line on each of many pages
+
+/* Memory region flushed by CTIMER_COLD_FLUSH */
+typedef struct
+{
+    void * addr;
+    size_t len;
+} ctimer_region_t;
+
+/* Datatype
+ *  cold-start measurement configuration
+ *   - iterations -> number of cold and warm runs each
+ *   - clock -> clock the runs are measured with
+ *   - flags -> CTIMER_COLD_* flags
+ *   - evict_bytes -> size of the eviction buffer, 0 for twice the last
+ *     level cache
+ *   - regions, nregions -> regions flushed with CTIMER_COLD_FLUSH
+ */
+typedef struct
+{
+    int64_t iterations;
+    ctimer_clock_e clock;
+    int flags;
+    int64_t evict_bytes;
+    ctimer_region_t * regions;
+    int nregions;
+} ctimer_cold_t;
+
+/* Datatype
+ *  cold-start measurement results
+ *   - cold -> durations of the runs right after the eviction
+ *   - warm -> durations of the runs repeated right after them
+ *   - errors -> runs that returned a status other than OK
+ */
+typedef struct
+{
+    ctimer_hist_t * cold;
+    ctimer_hist_t * warm;
+    int64_t errors;
+} ctimer_cold_result_t;
+
+/* Enum of thread placements */
+typedef enum
+{
+    CTIMER_PLACE_NONE,    // leave placement to the scheduler
+    CTIMER_PLACE_COMPACT, // pin threads filling one NUMA node after the other
+    CTIMER_PLACE_SPREAD   // pin threads to the NUMA nodes in turn
+} ctimer_place_e;
+
+/* Operation run by ctimer_scale_run() on every thread, thread is the index
+ * of the calling thread. Returns a status code. */
+typedef int (*ctimer_scale_fn)(void * arg, int thread);
+
+/* Datatype
+ *  scalability run configuration, the thread counts are the powers of two
+ *  up to max_threads and max_threads itself
+ *   - max_threads -> largest number of threads, at most CTIMER_MAX_THREADS
+ *   - ops -> operations run by every thread
+ *   - clock -> clock the threads are measured with
+ *   - place -> thread placement
+ */
+typedef struct
+{
+    int max_threads;
+    int64_t ops;
+    ctimer_clock_e clock;
+    ctimer_place_e place;
+} ctimer_scale_t;
+
+/* Datatype
+ *  scalability run results, one entry per thread count
+ *   - points -> number of thread counts measured
+ *   - threads -> the thread count
+ *   - elapsed -> nano-seconds from the first thread starting to the last
+ *     one finishing
+ *   - throughput -> operations per second of all threads together
+ *   - speedup -> throughput relative to the single thread
+ *   - efficiency -> speedup divided by the thread count
+ *   - imbalance -> slowest thread time divided by the fastest one
+ *   - errors -> operations that returned a status other than OK
+ */
+typedef struct
+{
+    int points;
+    int threads[CTIMER_MAX_THREADS];
+    int64_t elapsed[CTIMER_MAX_THREADS];
+    double throughput[CTIMER_MAX_THREADS];
+    double speedup[CTIMER_MAX_THREADS];
+    double efficiency[CTIMER_MAX_THREADS];
+    double imbalance[CTIMER_MAX_THREADS];
+    int64_t errors;
+} ctimer_scale_result_t;
+
+/* Datatype
+ *  one recorded interval of a trace
+ *   - start, stop -> nano-seconds of the trace clock
+ *   - name -> name id, see ctimer_trace_name()
+ *   - thread -> kernel thread id of the recording thread
+ *   - cpu, node -> CPU and NUMA node the sample was recorded on
+ *   - id -> id other samples refer to as their parent, 0 if none
+ *   - parent -> id of the sample this one is part of, 0 if none
+ */
+typedef struct
+{
+    int64_t start;
+    int64_t stop;
+    uint32_t name;
+    uint32_t thread;
+    uint16_t cpu;
+    uint16_t node;
+    uint32_t id;
+    uint32_t parent;
+    uint32_t reserved;
+} ctimer_sample_t;
+
+/* Flags of ctimer_create_trace() */
+#define CTIMER_TRACE_HUGE 1   // back the thread buffers with huge pages if possible
+#define CTIMER_TRACE_RING 2   // full buffers overwrite their oldest samples
+
+/* How the memory of a thread buffer is backed */
+#define CTIMER_PAGES_NORMAL 0
+#define CTIMER_PAGES_HUGETLB 1   // reserved huge pages, MAP_HUGETLB
+#define CTIMER_PAGES_THP 2       // transparent huge pages requested with madvise
+
+/* Datatype
+ *  recording buffer of one thread, allocated on the NUMA node the thread
+ *  ran on when it recorded its first sample
+ *   - samples, capacity, count -> the recorded samples; with
+ *     CTIMER_TRACE_RING count keeps growing and sample i is found at
+ *     i % capacity while it is one of the last capacity ones
+ *   - thread, node -> owning thread and the node of the memory
+ *   - bytes -> size of the mapping holding the samples
+ *   - pages -> backing of the mapping, CTIMER_PAGES_*
+ *   - next -> next buffer of the trace
+ */
+typedef struct ctimer_tbuf
+{
+    ctimer_sample_t * samples;
+    int64_t capacity;
+    int64_t count;
+    uint32_t thread;
+    int node;
+    size_t bytes;
+    int pages;
+    struct ctimer_tbuf * next;
+} ctimer_tbuf_t;
+
+/* Datatype
+ *  trace of intervals recorded by any number of threads, each thread
+ *  writes to its own buffer only
+ *   - clock -> clock of the sample times
+ *   - capacity -> samples per thread buffer
+ *   - flags -> CTIMER_TRACE_* flags
+ *   - id -> unique id, identifies the trace in thread-local caches
+ *   - ids -> last sample id handed out, see ctimer_trace_id()
+ *   - buffers -> list of the thread buffers
+ *   - dropped -> samples lost to full buffers
+ *   - names, nnames, naming -> name table and its lock
+ *   - nodes -> number of NUMA nodes, buffers are bound to a node if above 1
+ *   - epoch -> wall time mapping of the clock, sampled whenever the trace
+ *     is written; empty for CPU-time clocks
+ */
+typedef struct
+{
+    ctimer_clock_e clock;
+    int64_t capacity;
+    int flags;
+    uint64_t id;
+    uint32_t ids;
+    ctimer_tbuf_t * buffers;
+    int64_t dropped;
+    char * names[CTIMER_TRACE_NAMES];
+    int nnames;
+    int naming;
+    int nodes;
+    ctimer_epoch_t epoch;
+} ctimer_trace_t;
+
+/* Magic numbers of trace files, see ctimer_trace_write() */
+#define CTIMER_TRACE_MAGIC 0x46525443   // "CTRF"
+#define CTIMER_BLOCK_MAGIC 0x4b4c4243   // "CBLK"
+#define CTIMER_TRACE_VERSION 3
+
+/* Datatype
+ *  header of a block of a trace file, followed by `bytes` bytes of encoded
+ *  samples of one thread
+ *   - thread -> kernel thread id of the samples
+ *   - count -> number of samples
+ *   - base -> start time the first delta refers to
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t thread;
+    uint32_t count;
+    uint32_t bytes;
+    int64_t base;
+} ctimer_block_t;
+
+/* Datatype
+ *  trace file mapped into memory, with the offsets of its blocks
+ *   - data, size -> the mapping
+ *   - version -> format version of the file
+ *   - clock -> clock of the sample times
+ *   - names, nnames -> the name table, names[id] is the name of id
+ *   - epoch -> wall time mapping stored with the samples, empty before
+ *     version 3
+ *   - blocks, nblocks -> offsets of the block headers
+ *   - samples -> total number of samples
+ */
+typedef struct
+{
+    const uint8_t * data;
+    size_t size;
+    uint32_t version;
+    ctimer_clock_e clock;
+    char * names[CTIMER_TRACE_NAMES];
+    int nnames;
+    ctimer_epoch_t epoch;
+    size_t * blocks;
+    int64_t nblocks;
+    int64_t samples;
+} ctimer_trace_file_t;
+
+/* Datatype
+ *  state of decoding one block of a trace file sample by sample
+ *   - p, end -> the encoded samples not decoded yet
+ *   - left -> number of samples not decoded yet
+ *   - prev, delta -> previous start time and start time difference
+ *   - id -> previous sample id
+ *   - thread -> thread id of the block
+ *   - version -> format version of the file
+ */
+typedef struct
+{
+    const uint8_t * p;
+    const uint8_t * end;
+    int64_t left;
+    int64_t prev;
+    int64_t delta;
+    uint32_t id;
+    uint32_t thread;
+    uint32_t version;
+} ctimer_decoder_t;
+
+/* Datatype
+ *  statistics of a trace file, see ctimer_analyze_trace_file()
+ *   - nnames, names -> name table, pointing into the trace file
+ *   - hists -> histogram of the lengths of every name, NULL for names
+ *     without samples
+ *   - nthreads, threads -> thread ids found in the file, ascending
+ *   - count, total -> number and summed length of the samples of name n
+ *     and thread i at [n * nthreads + i]
+ *   - ntop, top -> the slowest samples, slowest first
+ *   - epoch -> wall time mapping of the file, empty before version 3
+ *   - samples -> number of samples analysed
+ *   - errors -> number of broken blocks skipped
+ */
+typedef struct
+{
+    int nnames;
+    char * names[CTIMER_TRACE_NAMES];
+    ctimer_hist_t * hists[CTIMER_TRACE_NAMES];
+    int nthreads;
+    uint32_t * threads;
+    int64_t * count;
+    int64_t * total;
+    int ntop;
+    ctimer_sample_t top[CTIMER_ANALYZE_TOP];
+    ctimer_epoch_t epoch;
+    int64_t samples;
+    int64_t errors;
+} ctimer_analysis_t;
+
+/* Datatype
+ *  part of a critical path during which one sample was running and none of
+ *  its children was on the path
+ *   - id, name, thread -> the sample
+ *   - start, stop -> the part of the sample on the path
+ */
+typedef struct
+{
+    uint32_t id;
+    uint32_t name;
+    uint32_t thread;
+    int64_t start;
+    int64_t stop;
+} ctimer_segment_t;
+
+/* Datatype
+ *  critical path of a sample, see ctimer_critical_path()
+ *   - root -> index of the root sample
+ *   - nsegs, segs -> the segments in the order of time
+ *   - truncated -> number of segments beyond CTIMER_PATH_SEGMENTS, dropped
+ */
+typedef struct
+{
+    int64_t root;
+    int nsegs;
+    ctimer_segment_t segs[CTIMER_PATH_SEGMENTS];
+    int64_t truncated;
+} ctimer_path_t;
+
+/* Datatype
+ *  interval captured by a slow-log
+ *   - name -> name of the interval
+ *   - clock -> clock of the interval
+ *   - start, stop -> nano-seconds of that clock
+ *   - thread -> kernel thread id of the thread that stopped it
+ *   - depth -> number of enclosing scopes, of which the outermost up to
+ *     CTIMER_SCOPE_DEPTH are named in scopes
+ */
+typedef struct
+{
+    char * name;
+    ctimer_clock_e clock;
+    int64_t start;
+    int64_t stop;
+    uint32_t thread;
+    int depth;
+    char * scopes[CTIMER_SCOPE_DEPTH];
+} ctimer_slow_t;
+
+/* Datatype
+ *  bounded log of the intervals that took longer than a threshold
+ *   - threshold -> nano-seconds above which an interval is captured
+ *   - captured -> number of intervals captured so far
+ *   - lock -> spin lock of the entries
+ *   - entries -> ring of the latest CTIMER_SLOW_ENTRIES captures, entry
+ *     captured % CTIMER_SLOW_ENTRIES is written next
+ */
+typedef struct
+{
+    int64_t threshold;
+    int64_t captured;
+    int lock;
+    ctimer_slow_t entries[CTIMER_SLOW_ENTRIES];
+} ctimer_slowlog_t;
+
+/* Benchmark run by ctimer_sweep_run() for a parameter n, returns a status
+ * code */
+typedef int (*ctimer_sweep_fn)(void * arg, int64_t n);
+
+/* Enum of complexity curves fitted to a sweep */
+typedef enum
+{
+    CTIMER_O1,      // constant
+    CTIMER_OLOGN,   // log n
+    CTIMER_ON,      // n
+    CTIMER_ONLOGN,  // n log n
+    CTIMER_ON2,     // n^2
+    CTIMER_ON3,     // n^3
+    CTIMER_FITS     // number of curves
+} ctimer_big_o_e;
+
+/* Datatype
+ *  parameter sweep configuration, n runs from `from` up to and including
+ *  `to`, multiplied by `mult` if that is above 1, otherwise incremented by
+ *  `step`
+ *   - repeats -> measured runs per point
+ *   - clock -> clock the runs are measured with
+ */
+typedef struct
+{
+    int64_t from;
+    int64_t to;
+    int64_t mult;
+    int64_t step;
+    int64_t repeats;
+    ctimer_clock_e clock;
+} ctimer_sweep_t;
+
+/* Datatype
+ *  parameter sweep results, times are nano-seconds per run
+ *   - points -> number of points measured
+ *   - n, mean, min -> parameter, mean and fastest run of every point
+ *   - errors -> runs that returned a status other than OK
+ *   - coef -> least squares factor of each curve, time = coef * f(n)
+ *   - rms -> root mean square error of each fit relative to the mean time
+ *   - best -> curve with the smallest rms
+ */
+typedef struct
+{
+    int points;
+    int64_t n[CTIMER_SWEEP_POINTS];
+    int64_t mean[CTIMER_SWEEP_POINTS];
+    int64_t min[CTIMER_SWEEP_POINTS];
+    int64_t errors;
+    double coef[CTIMER_FITS];
+    double rms[CTIMER_FITS];
+    ctimer_big_o_e best;
+} ctimer_sweep_result_t;
+
+/** Declarations **/
+
+/* The library is built with -fvisibility=hidden, only the functions declared
+ * here are exported from libctimer.so */
+#if defined(__GNUC__) && __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+char * ctimer_error_num(int status);
+clockid_t ctimer_set_clock(ctimer_clock_e ck);
+struct timespec ctimer_diff_timespec(struct timespec a, struct timespec b);
+int ctimer_set_timespec(struct timespec ** tims, long sec, long nsec);
+char * ctimer_print_unit(ctimer_unit_e unit);
+int ctimer_create_interval(ctimer_interval_t ** tmp, char * name, ctimer_clock_e ck, ctimer_unit_e ut);
+int ctimer_get_time(clockid_t clock, struct timespec * time);
+int ctimer_get_clock_time(ctimer_clock_e ck, struct timespec * time);
+int64_t ctimer_get_clock_ns(ctimer_clock_e ck);
+int ctimer_set_backend(ctimer_backend_e be);
+int ctimer_cached_clock_start(ctimer_clock_e source, int64_t period);
+int ctimer_cached_clock_stop(void);
+int64_t ctimer_cached_now_ns(void);
+uint64_t ctimer_read_ticks(void);
+int ctimer_calibrate_tsc(int msec);
+ctimer_tsc_calib_t * ctimer_get_tsc_calib(void);
+int64_t ctimer_ticks_to_ns(uint64_t ticks);
+int ctimer_epoch_init(ctimer_epoch_t * ep, ctimer_clock_e ck);
+int ctimer_epoch_sample(ctimer_epoch_t * ep);
+int64_t ctimer_epoch_to_realtime(ctimer_epoch_t * ep, int64_t nsec);
+int ctimer_format_utc(int64_t realtime, char * buf, size_t len);
+int ctimer_wait_until(ctimer_clock_e ck, int64_t target);
+int ctimer_wait_for(ctimer_clock_e ck, int64_t nsec);
+void ctimer_set_wait_spin(int64_t nsec);
+ctimer_wait_stats_t * ctimer_get_wait_stats(void);
+void ctimer_print_wait_stats(void);
+int ctimer_create_rate(ctimer_rate_t ** tmp, ctimer_clock_e ck);
+void ctimer_rate_reset(ctimer_rate_t * m);
+void ctimer_rate_mark(ctimer_rate_t * m, int64_t events, int64_t bytes);
+void ctimer_rate_get(ctimer_rate_t * m, ctimer_rate_report_t * rep);
+void ctimer_print_rate(ctimer_rate_t * m, char * name);
+void ctimer_attach_rate(ctimer_interval_t * tmp, ctimer_rate_t * m);
+int ctimer_create_hist(ctimer_hist_t ** tmp);
+void ctimer_hist_reset(ctimer_hist_t * h);
+void ctimer_hist_record(ctimer_hist_t * h, int64_t value);
+void ctimer_hist_merge(ctimer_hist_t * dst, ctimer_hist_t * src);
+int64_t ctimer_hist_percentile(ctimer_hist_t * h, double p);
+double ctimer_hist_mean(ctimer_hist_t * h);
+void ctimer_print_hist(ctimer_hist_t * h, char * name, ctimer_unit_e ut);
+void ctimer_hist_record_atomic(ctimer_hist_t * h, int64_t value);
+int ctimer_create_whist(ctimer_whist_t ** tmp, ctimer_clock_e ck, int64_t period, int slots);
+void ctimer_free_whist(ctimer_whist_t * w);
+void ctimer_whist_record(ctimer_whist_t * w, int64_t value);
+void ctimer_whist_get(ctimer_whist_t * w, int64_t window, ctimer_hist_t * out);
+int ctimer_loadgen_run(ctimer_loadgen_t * cfg, ctimer_loadgen_fn fn, void * arg, ctimer_loadgen_result_t * res);
+void ctimer_print_loadgen(ctimer_loadgen_result_t * res, ctimer_unit_e ut);
+int ctimer_ab_run(ctimer_ab_t * cfg, ctimer_ab_fn fn_a, void * arg_a, ctimer_ab_fn fn_b, void * arg_b,
+                  ctimer_ab_result_t * res);
+int ctimer_ab_exec(char * const * argv);
+int ctimer_ab_run_exec(ctimer_ab_t * cfg, char * const * argv_a, char * const * argv_b,
+                       ctimer_ab_result_t * res);
+void ctimer_print_ab(ctimer_ab_result_t * res, char * name_a, char * name_b, ctimer_unit_e ut);
+int ctimer_cold_run(ctimer_cold_t * cfg, ctimer_cold_fn fn, void * arg, ctimer_cold_result_t * res);
+void ctimer_flush_region(void * addr, size_t len);
+void ctimer_print_cold(ctimer_cold_result_t * res, char * name, ctimer_unit_e ut);
+int ctimer_cpu_node(int cpu);
+int ctimer_cpu_order(int * cpus, int max, ctimer_place_e place);
+int ctimer_numa_nodes(void);
+int ctimer_create_trace(ctimer_trace_t ** tmp, ctimer_clock_e ck, int64_t capacity, int flags);
+void ctimer_free_trace(ctimer_trace_t * t);
+int ctimer_trace_name(ctimer_trace_t * t, const char * name);
+int ctimer_trace_record(ctimer_trace_t * t, int name, int64_t start, int64_t stop);
+uint32_t ctimer_trace_id(ctimer_trace_t * t);
+int ctimer_trace_record_span(ctimer_trace_t * t, int name, uint32_t id, uint32_t parent, int64_t start, int64_t stop);
+int64_t ctimer_trace_collect(ctimer_trace_t * t, ctimer_sample_t ** samples);
+int ctimer_trace_interval(ctimer_trace_t * t, ctimer_interval_t * iv);
+void ctimer_print_trace(ctimer_trace_t * t, ctimer_unit_e ut);
+int ctimer_trace_write(ctimer_trace_t * t, const char * path);
+int ctimer_open_trace_file(ctimer_trace_file_t ** tmp, const char * path);
+void ctimer_close_trace_file(ctimer_trace_file_t * f);
+int ctimer_decode_block(ctimer_decoder_t * d, ctimer_trace_file_t * f, int64_t block);
+int ctimer_decode_next(ctimer_decoder_t * d, ctimer_sample_t * s);
+int ctimer_analyze_trace_file(ctimer_analysis_t ** tmp, ctimer_trace_file_t * f, int workers, int top);
+void ctimer_free_analysis(ctimer_analysis_t * a);
+void ctimer_print_analysis(ctimer_analysis_t * a, ctimer_unit_e ut);
+int ctimer_flight_start(ctimer_trace_t * t, const char * path, int64_t window);
+int ctimer_flight_dump(const char * path);
+void ctimer_flight_stop(void);
+int ctimer_create_slowlog(ctimer_slowlog_t ** tmp, int64_t threshold);
+void ctimer_slowlog_threshold(ctimer_slowlog_t * log, int64_t threshold);
+void ctimer_slowlog_adapt(ctimer_slowlog_t * log, ctimer_hist_t * h, double p);
+int ctimer_slow_start(ctimer_interval_t * tmp);
+int ctimer_slow_stop(ctimer_slowlog_t * log, ctimer_interval_t * tmp);
+void ctimer_print_slowlog(ctimer_slowlog_t * log, ctimer_unit_e ut);
+int ctimer_critical_path(const ctimer_sample_t * samples, int64_t n, uint32_t root, ctimer_path_t * path);
+void ctimer_print_path(ctimer_path_t * path, const ctimer_sample_t * samples, char ** names, int nnames,
+                       ctimer_unit_e ut);
+int ctimer_scale_run(ctimer_scale_t * cfg, ctimer_scale_fn fn, void * arg, ctimer_scale_result_t * res);
+void ctimer_print_scale(ctimer_scale_result_t * res, char * name);
+int ctimer_sweep_run(ctimer_sweep_t * cfg, ctimer_sweep_fn fn, void * arg, ctimer_sweep_result_t * res);
+char * ctimer_print_big_o(ctimer_big_o_e fit);
+void ctimer_print_sweep(ctimer_sweep_result_t * res, char * name, ctimer_unit_e ut);
+void ctimer_print_sweep_csv(ctimer_sweep_result_t * res, char * comment, ctimer_unit_e ut);
+int ctimer_tsc_check(ctimer_tsc_report_t * rep, int rounds);
+void ctimer_print_tsc_report(ctimer_tsc_report_t * rep);
+int ctimer_start(ctimer_interval_t * tmp);
+int ctimer_stop(ctimer_interval_t * tmp);
+int ctimer_start_fenced(ctimer_interval_t * tmp);
+int ctimer_stop_fenced(ctimer_interval_t * tmp);
+double ctimer_elapsed_interval(ctimer_interval_t * tmp, ctimer_unit_e ut);
+int64_t ctimer_timespec_to_ns(struct timespec time);
+struct timespec ctimer_ns_to_timespec(int64_t nsec);
+int64_t ctimer_ns_to_unit_int(int64_t nsec, ctimer_unit_e ut);
+double ctimer_ns_to_unit(int64_t nsec, ctimer_unit_e ut);
+int64_t ctimer_elapsed_interval_ns(ctimer_interval_t * tmp);
+int64_t ctimer_elapsed_interval_int(ctimer_interval_t * tmp, ctimer_unit_e ut);
+void ctimer_print_results(int num, ...);
+void ctimer_print_results_csv(char * comment, int num, ...);
+
+#if defined(__GNUC__) && __GNUC__ >= 4
+#pragma GCC visibility pop
+#endif
+
+#if __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,210 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "timer_internal.h"
+
+#if CTIMER_EPOCH_SAMPLES < 4 || CTIMER_EPOCH_SAMPLES % 4
+#error "CTIMER_EPOCH_SAMPLES must be a multiple of 4"
+#endif
+
+/** Functions **/
+
+/* Function
+ *  internal function that reads the i-th pair, racing with the writer; the
+ *  caller checks the sequence counter afterwards
+ */
+static inline
+ctimer_epoch_pair_t epoch_pair(ctimer_epoch_t * ep, int i)
+{
+    ctimer_epoch_pair_t pair;
+
+    pair.clock = __atomic_load_n(&ep->pairs[i].clock, __ATOMIC_RELAXED);
+    pair.realtime = __atomic_load_n(&ep->pairs[i].realtime, __ATOMIC_RELAXED);
+    return pair;
+}
+
+/* Function
+ *  internal function that writes the i-th pair, within the writer section
+ */
+static inline
+void epoch_set_pair(ctimer_epoch_t * ep, int i, ctimer_epoch_pair_t pair)
+{
+    __atomic_store_n(&ep->pairs[i].clock, pair.clock, __ATOMIC_RELAXED);
+    __atomic_store_n(&ep->pairs[i].realtime, pair.realtime, __ATOMIC_RELAXED);
+}
+
+/* Function
+ *  initialise a wall time mapping for the given clock and record the
+ *  first paired sample.
+ *
+ *  @param ep: the mapping
+ *  @param ck: clock enum, must not be a CPU-time clock
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_epoch_init(ctimer_epoch_t * ep, ctimer_clock_e ck)
+{
+    CHECK(!ep, "No epoch given!");
+    CHECK(ck == CTIMER_CPUP || ck == CTIMER_CPUT, "CPU-time clocks can not be mapped to wall time!");
+    memset(ep, 0, sizeof(ctimer_epoch_t));
+    ep->clock = ck;
+    CHECK(ck == CTIMER_TSC && ctimer_calibrate_tsc(CTIMER_TSC_CALIBRATE_MSEC),
+          "Unable to calibrate the tick counter!");
+    return ctimer_epoch_sample(ep);
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  record a paired (clock, CLOCK_REALTIME) sample. Call this periodically,
+ *  e.g. once a second from a housekeeping thread, so that conversions can
+ *  interpolate over NTP adjustments. The clock is read on both sides of
+ *  CLOCK_REALTIME and the tightest of a few attempts is kept.
+ *  When the pairs fill up, every other pair of the older half is dropped,
+ *  so the mapping spans the whole run and is densest for recent times.
+ *  Conversions may run concurrently; a sample asked for while another one
+ *  is being recorded is skipped.
+ *
+ *  @param ep: the mapping
+ *
+ *  @return: either OK, CTIMER_NOT_ALLOCATED if skipped, or error status
+ *           from clock_gettime
+ */
+int ctimer_epoch_sample(ctimer_epoch_t * ep)
+{
+    return ctimer_epoch_sample_copy(ep, NULL, NULL);
+}
+
+/* Function
+ *  internal function recording a sample like ctimer_epoch_sample() and, if
+ *  `copy` is given, copying the pairs to it before the next sample can
+ *  change them. It neither allocates nor locks, so it is safe in signal
+ *  handlers; `ncopy` is left alone when the sample fails or is skipped.
+ */
+int ctimer_epoch_sample_copy(ctimer_epoch_t * ep, ctimer_epoch_pair_t * copy, int * ncopy)
+{
+    struct timespec before, after, real;
+    int64_t best = INT64_MAX;
+    ctimer_epoch_pair_t pair = {0, 0};
+    uint32_t seq;
+    int ret, n;
+
+    for(int i = 0; i < 4; i++)
+    {
+        ret = ctimer_get_clock_time(ep->clock, &before);
+        if(ret == CTIMER_OK) ret = ctimer_get_time(CLOCK_REALTIME, &real);
+        if(ret == CTIMER_OK) ret = ctimer_get_clock_time(ep->clock, &after);
+        if(ret != CTIMER_OK) return ret;
+
+        int64_t width = ctimer_timespec_to_ns(after) - ctimer_timespec_to_ns(before);
+        if(width < best)
+        {
+            best = width;
+            pair.clock = ctimer_timespec_to_ns(before) + width / 2;
+            pair.realtime = ctimer_timespec_to_ns(real);
+        }
+    }
+
+    /* An odd sequence marks the writer, readers retry around it */
+    seq = __atomic_load_n(&ep->seq, __ATOMIC_RELAXED);
+    if((seq & 1) || !__atomic_compare_exchange_n(&ep->seq, &seq, seq + 1, 0, __ATOMIC_ACQUIRE,
+                                                 __ATOMIC_RELAXED))
+        return CTIMER_NOT_ALLOCATED;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    n = ep->count;
+    if(n == CTIMER_EPOCH_SAMPLES)
+    {
+        /* Keep the first pair and every other of the older half */
+        for(int i = 1; i < CTIMER_EPOCH_SAMPLES / 4; i++)
+            epoch_set_pair(ep, i, ep->pairs[2 * i]);
+        for(int i = 0; i < CTIMER_EPOCH_SAMPLES / 2; i++)
+            epoch_set_pair(ep, CTIMER_EPOCH_SAMPLES / 4 + i, ep->pairs[CTIMER_EPOCH_SAMPLES / 2 + i]);
+        n = CTIMER_EPOCH_SAMPLES / 4 + CTIMER_EPOCH_SAMPLES / 2;
+    }
+    epoch_set_pair(ep, n, pair);
+    __atomic_store_n(&ep->count, n + 1, __ATOMIC_RELAXED);
+    if(copy)
+    {
+        memcpy(copy, ep->pairs, (size_t) (n + 1) * sizeof(ctimer_epoch_pair_t));
+        *ncopy = n + 1;
+    }
+    __atomic_store_n(&ep->seq, seq + 2, __ATOMIC_RELEASE);
+    return CTIMER_OK;
+}
+
+/* Function
+ *  convert a timestamp of the mapped clock to CLOCK_REALTIME by linear
+ *  interpolation between the surrounding paired samples. Timestamps
+ *  outside the sampled range are extrapolated from the nearest two.
+ *
+ *  @param ep: the mapping
+ *  @param nsec: the timestamp in nano-seconds
+ *
+ *  @return: the wall time in nano-seconds since the Unix epoch
+ */
+int64_t ctimer_epoch_to_realtime(ctimer_epoch_t * ep, int64_t nsec)
+{
+    ctimer_epoch_pair_t a, b;
+    uint32_t seq;
+    int count;
+
+    /* Seqlock read: retry when a sample was recorded meanwhile */
+    do
+    {
+        while((seq = __atomic_load_n(&ep->seq, __ATOMIC_ACQUIRE)) & 1);
+        count = __atomic_load_n(&ep->count, __ATOMIC_RELAXED);
+        if(count == 0) return 0;
+
+        /* Find the segment [lo, lo + 1] containing nsec */
+        int lo = 0, hi = count - 1;
+        while(hi - lo > 1)
+        {
+            int mid = lo + (hi - lo) / 2;
+            if(epoch_pair(ep, mid).clock <= nsec) lo = mid;
+            else hi = mid;
+        }
+        a = epoch_pair(ep, lo);
+        b = epoch_pair(ep, hi);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while(__atomic_load_n(&ep->seq, __ATOMIC_RELAXED) != seq);
+
+    int64_t dc = b.clock - a.clock;
+    int64_t dr = b.realtime - a.realtime;
+    int64_t delta = nsec - a.clock;
+    if(dc <= 0) return a.realtime + delta;
+
+    /* Only the small rate correction needs floating point */
+    return a.realtime + delta + (int64_t) ((double) delta * (dr - dc) / dc);
+}
+
+/* Function
+ *  format a CLOCK_REALTIME timestamp as ISO 8601 UTC with nano-seconds,
+ *  e.g. 2016-01-31T12:00:00.000000000Z
+ *
+ *  @param realtime: nano-seconds since the Unix epoch
+ *  @param buf: the output buffer
+ *  @param len: size of the output buffer, at least 31 bytes
+ *
+ *  @return: either OK, or CTIMER_NOT_ALLOCATED if the buffer is too small
+ */
+int ctimer_format_utc(int64_t realtime, char * buf, size_t len)
+{
+    struct timespec time = ctimer_ns_to_timespec(realtime);
+    struct tm tm;
+    size_t n;
+
+    CHECK(!gmtime_r(&time.tv_sec, &tm), "Unable to convert %lld to UTC",
+          (long long) time.tv_sec);
+    n = strftime(buf, len, "%Y-%m-%dT%H:%M:%S", &tm);
+    CHECK(!n || n + 12 > len, "Buffer too small for UTC time!");
+    snprintf(buf + n, len - n, ".%09ldZ", (long) time.tv_nsec);
+    return CTIMER_OK;
+
+error:
+    return CTIMER_NOT_ALLOCATED;
+}
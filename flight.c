@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "timer_internal.h"
+
+/* Fatal signals the recorder dumps on before handing them on */
+static const int fatal_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+#define NFATAL ((int) (sizeof(fatal_signals) / sizeof(fatal_signals[0])))
+
+/** Globals **/
+
+/* The recorder, set up by ctimer_flight_start(); everything a dump needs
+ * is allocated beforehand so that the signal handlers do not allocate */
+static ctimer_trace_t * flight_trace = NULL;
+static char flight_path[4096];
+static int64_t flight_window = 0;
+static uint8_t * flight_out = NULL;
+static int flight_dumping = 0;
+static struct sigaction flight_old_usr2;
+static struct sigaction flight_old_fatal[NFATAL];
+static stack_t flight_stack = {NULL, 0, 0};
+static stack_t flight_old_stack;
+
+/** Functions **/
+
+/* Function
+ *  internal signal handler, dumps on SIGUSR2 and goes on; errno is kept
+ *  for the interrupted code
+ */
+static
+void flight_on_demand(int sig)
+{
+    int saved = errno;
+
+    (void) sig;
+    ctimer_flight_dump(NULL);
+    errno = saved;
+}
+
+/* Function
+ *  internal signal handler, dumps on a fatal signal and then hands it on:
+ *  to the handler it replaced, e.g. a crash reporter, or else to the
+ *  default action, which SA_RESETHAND restored on entry
+ */
+static
+void flight_on_fatal(int sig, siginfo_t * info, void * ctx)
+{
+    struct sigaction * old = NULL;
+    int saved = errno;
+
+    ctimer_flight_dump(NULL);
+    for(int i = 0; i < NFATAL; i++)
+        if(fatal_signals[i] == sig) old = &flight_old_fatal[i];
+    errno = saved;
+
+    if(old && (old->sa_flags & SA_SIGINFO))
+        old->sa_sigaction(sig, info, ctx);
+    else if(old && old->sa_handler != SIG_DFL && old->sa_handler != SIG_IGN)
+        old->sa_handler(sig);
+    else
+        raise(sig);
+}
+
+/* Function
+ *  start a flight recorder: the trace, best created with CTIMER_TRACE_RING
+ *  so that every thread keeps its latest samples, is dumped to a trace file
+ *  on ctimer_flight_dump(), on SIGUSR2 and, best effort, when the process
+ *  dies of SIGSEGV, SIGBUS, SIGFPE, SIGILL or SIGABRT. Dumps keep the
+ *  samples that stopped within the window before the dump. There is one
+ *  recorder per process; the handlers run on an alternate stack only on
+ *  the thread that started it.
+ *
+ *  @param t: the trace
+ *  @param path: the file dumps replace
+ *  @param window: nano-seconds of samples to dump, 0 for all
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_flight_start(ctimer_trace_t * t, const char * path, int64_t window)
+{
+    struct sigaction sa;
+
+    /* Refuse before touching any state, the error path below frees what
+     * the running recorder uses */
+    if(flight_trace)
+    {
+        ERROR("A flight recorder is running already!");
+        return CTIMER_CALL_FAILED;
+    }
+    CHECK(strlen(path) >= sizeof(flight_path), "Path too long: %s", path);
+    flight_out = (uint8_t *) malloc((size_t) CTIMER_TRACE_BLOCK * CTIMER_SAMPLE_MAX);
+    CHECK(!flight_out, "Unable to allocate the flight recorder!");
+    strcpy(flight_path, path);
+    flight_window = window;
+
+    flight_stack.ss_sp = malloc(SIGSTKSZ);
+    flight_stack.ss_size = SIGSTKSZ;
+    if(!flight_stack.ss_sp || sigaltstack(&flight_stack, &flight_old_stack))
+    {
+        DEBUG("No alternate signal stack, dumps after a stack overflow fail");
+        free(flight_stack.ss_sp);
+        flight_stack.ss_sp = NULL;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART | SA_ONSTACK;
+    sa.sa_handler = flight_on_demand;
+    CHECK(sigaction(SIGUSR2, &sa, &flight_old_usr2), "Unable to handle SIGUSR2");
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+    sa.sa_sigaction = flight_on_fatal;
+    for(int i = 0; i < NFATAL; i++)
+        sigaction(fatal_signals[i], &sa, &flight_old_fatal[i]);
+
+    __atomic_store_n(&flight_trace, t, __ATOMIC_RELEASE);
+    return CTIMER_OK;
+
+error:
+    if(flight_stack.ss_sp)
+    {
+        sigaltstack(&flight_old_stack, NULL);
+        free(flight_stack.ss_sp);
+        flight_stack.ss_sp = NULL;
+    }
+    free(flight_out);
+    flight_out = NULL;
+    return CTIMER_CALL_FAILED;
+}
+
+/* Function
+ *  dump the flight recorder to a trace file, while the threads go on
+ *  recording. This is async-signal-safe; a dump that is asked for while
+ *  another one runs is skipped.
+ *
+ *  @param path: the file to replace, NULL for the one of the recorder
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_flight_dump(const char * path)
+{
+    ctimer_trace_t * t;
+    int64_t since = INT64_MIN;
+    int fd, ret;
+
+    /* Mark the dump before looking at the recorder, ctimer_flight_stop()
+     * waits for marked dumps */
+    if(__atomic_exchange_n(&flight_dumping, 1, __ATOMIC_ACQUIRE)) return CTIMER_NOT_ALLOCATED;
+    if(!(t = __atomic_load_n(&flight_trace, __ATOMIC_ACQUIRE)))
+    {
+        __atomic_store_n(&flight_dumping, 0, __ATOMIC_RELEASE);
+        return CTIMER_NOT_ALLOCATED;
+    }
+    if(flight_window > 0) since = ctimer_get_clock_ns(t->clock) - flight_window;
+    fd = open(path ? path : flight_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ret = fd < 0 ? CTIMER_CALL_FAILED : ctimer_trace_write_fd(t, fd, flight_out, since);
+    if(fd >= 0 && close(fd)) ret = CTIMER_CALL_FAILED;
+    __atomic_store_n(&flight_dumping, 0, __ATOMIC_RELEASE);
+    return ret;
+}
+
+/* Function
+ *  stop the flight recorder and restore the previous signal handlers and,
+ *  when called on the thread that started it, the previous alternate
+ *  signal stack; the trace is left to the caller
+ */
+void ctimer_flight_stop(void)
+{
+    if(!flight_trace) return;
+    sigaction(SIGUSR2, &flight_old_usr2, NULL);
+    for(int i = 0; i < NFATAL; i++)
+        sigaction(fatal_signals[i], &flight_old_fatal[i], NULL);
+
+    /* Take the dump mark like a dump does, so a dump either finishes
+     * before the recorder goes or sees it gone */
+    while(__atomic_exchange_n(&flight_dumping, 1, __ATOMIC_ACQUIRE));
+    __atomic_store_n(&flight_trace, NULL, __ATOMIC_RELEASE);
+    if(flight_stack.ss_sp)
+    {
+        sigaltstack(&flight_old_stack, NULL);
+        free(flight_stack.ss_sp);
+        flight_stack.ss_sp = NULL;
+    }
+    free(flight_out);
+    flight_out = NULL;
+    __atomic_store_n(&flight_dumping, 0, __ATOMIC_RELEASE);
+}
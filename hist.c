@@ -0,0 +1,346 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "timer_internal.h"
+
+/** Functions **/
+
+/* Function
+ *  internal function that maps a value to its bucket. Values below
+ *  2^CTIMER_HIST_PRECISION get a bucket each, above that every power of two is
+ *  split into 2^(CTIMER_HIST_PRECISION - 1) buckets.
+ */
+static inline
+int hist_index(int64_t value)
+{
+    int bits, shift;
+
+    if(value < (1 << CTIMER_HIST_PRECISION)) return value < 0 ? 0 : (int) value;
+    bits = 64 - __builtin_clzll((unsigned long long) value);
+    shift = bits - CTIMER_HIST_PRECISION;
+    return (shift << (CTIMER_HIST_PRECISION - 1)) + (int) (value >> shift);
+}
+
+/* Function
+ *  internal function returning the largest value that maps to a bucket
+ */
+static inline
+int64_t hist_upper(int index)
+{
+    int shift;
+
+    if(index < (1 << CTIMER_HIST_PRECISION)) return index;
+    shift = (index >> (CTIMER_HIST_PRECISION - 1)) - 1;
+    return (((int64_t) (index - (shift << (CTIMER_HIST_PRECISION - 1)))) << shift)
+        + ((int64_t) 1 << shift) - 1;
+}
+
+/* Function
+ *  create a histogram, which means to allocate the underlying structure.
+ *  Release it with free().
+ *
+ *  @param tmp: the address of the histogram to be allocated
+ *
+ *  @return: status code
+ */
+int ctimer_create_hist(ctimer_hist_t ** tmp)
+{
+    *tmp = (ctimer_hist_t *) malloc(sizeof(ctimer_hist_t));
+    CHECK(!*tmp, "Unable to create histogram!");
+    ctimer_hist_reset(*tmp);
+    return CTIMER_OK;
+
+error:
+    return CTIMER_NOT_ALLOCATED;
+}
+
+/* Function
+ *  clear all recorded values of a histogram
+ *
+ *  @param h: the histogram
+ */
+void ctimer_hist_reset(ctimer_hist_t * h)
+{
+    memset(h, 0, sizeof(ctimer_hist_t));
+    h->min = INT64_MAX;
+}
+
+/* Function
+ *  record a value, negative values are counted as 0
+ *
+ *  @param h: the histogram
+ *  @param value: the value, usually nano-seconds
+ */
+inline
+void ctimer_hist_record(ctimer_hist_t * h, int64_t value)
+{
+    if(value < 0) value = 0;
+    h->buckets[hist_index(value)]++;
+    h->count++;
+    h->total += value;
+    if(value < h->min) h->min = value;
+    if(value > h->max) h->max = value;
+}
+
+/* Function
+ *  record a value, safe to call from several threads at once
+ *
+ *  @param h: the histogram
+ *  @param value: the value, usually nano-seconds
+ */
+void ctimer_hist_record_atomic(ctimer_hist_t * h, int64_t value)
+{
+    int64_t seen;
+
+    if(value < 0) value = 0;
+    __atomic_fetch_add(&h->buckets[hist_index(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total, value, __ATOMIC_RELAXED);
+
+    seen = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+    while(value < seen && !__atomic_compare_exchange_n(&h->min, &seen, value, 1,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    seen = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while(value > seen && !__atomic_compare_exchange_n(&h->max, &seen, value, 1,
+                                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/* Function
+ *  add all values recorded in one histogram to another
+ *
+ *  @param dst: the histogram added to
+ *  @param src: the histogram being added
+ */
+void ctimer_hist_merge(ctimer_hist_t * dst, ctimer_hist_t * src)
+{
+    for(int i = 0; i < CTIMER_HIST_BUCKETS; i++)
+        dst->buckets[i] += src->buckets[i];
+    dst->count += src->count;
+    dst->total += src->total;
+    if(src->min < dst->min) dst->min = src->min;
+    if(src->max > dst->max) dst->max = src->max;
+}
+
+/* Function
+ *  compute a percentile of the recorded values
+ *
+ *  @param h: the histogram
+ *  @param p: the percentile, between 0 and 100
+ *
+ *  @return: the largest value equivalent to the percentile within the
+ *           histogram precision, or 0 if nothing was recorded
+ */
+int64_t ctimer_hist_percentile(ctimer_hist_t * h, double p)
+{
+    int64_t rank, seen = 0;
+
+    if(h->count == 0) return 0;
+    if(p <= 0.0) return h->min;
+    if(p >= 100.0) return h->max;
+
+    rank = (int64_t) (p / 100.0 * h->count + 0.5);
+    if(rank < 1) rank = 1;
+    for(int i = 0; i < CTIMER_HIST_BUCKETS; i++)
+    {
+        seen += h->buckets[i];
+        if(seen >= rank)
+        {
+            int64_t value = hist_upper(i);
+            if(value < h->min) return h->min;
+            return value > h->max ? h->max : value;
+        }
+    }
+    return h->max;
+}
+
+/* Function
+ *  compute the mean of the recorded values
+ *
+ *  @param h: the histogram
+ *
+ *  @return: the mean, or 0.0 if nothing was recorded
+ */
+double ctimer_hist_mean(ctimer_hist_t * h)
+{
+    return h->count ? (double) h->total / h->count : 0.0;
+}
+
+/* Function
+ *  print the summary of a histogram
+ *
+ *  @param h: the histogram
+ *  @param name: printed in front of the summary
+ *  @param ut: unit enum of the printed values
+ */
+void ctimer_print_hist(ctimer_hist_t * h, char * name, ctimer_unit_e ut)
+{
+    static const double pcts[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+    char * unit = ctimer_print_unit(ut);
+
+    printf("%s: count %lld", name, (long long) h->count);
+    if(h->count == 0)
+    {
+        printf("\n");
+        return;
+    }
+    printf(", min %.3f %s, mean %.3f %s", ctimer_ns_to_unit(h->min, ut), unit,
+           ctimer_ns_to_unit((int64_t) ctimer_hist_mean(h), ut), unit);
+    for(unsigned int i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++)
+        printf(", p%g %.3f %s", pcts[i], ctimer_ns_to_unit(ctimer_hist_percentile(h, pcts[i]), ut), unit);
+    printf(", max %.3f %s\n", ctimer_ns_to_unit(h->max, ut), unit);
+}
+
+/* Function
+ *  internal function clearing a sub-histogram with atomic stores, a thread
+ *  stalled for a whole window may still add to it
+ */
+static
+void whist_clear(ctimer_hist_t * h)
+{
+    for(int i = 0; i < CTIMER_HIST_BUCKETS; i++)
+        __atomic_store_n(&h->buckets[i], 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->count, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->total, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->min, INT64_MAX, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->max, 0, __ATOMIC_RELAXED);
+}
+
+/* Function
+ *  internal function that moves the ring of a windowed histogram to the
+ *  current period. Entering a period clears the sub-histogram of the next
+ *  one, which only held values older than the window; a slot is handed
+ *  out only once its epoch is published. One thread rotates at a time, the
+ *  others carry on recording.
+ *
+ *  @return: the current period index
+ */
+static
+int64_t whist_advance(ctimer_whist_t * w, int64_t now)
+{
+    int64_t epoch = (now - w->begin) / w->period;
+    int64_t from;
+    int ring = w->slots + 1;
+
+    if(epoch <= __atomic_load_n(&w->current, __ATOMIC_ACQUIRE)) return epoch;
+    if(__atomic_exchange_n(&w->rotating, 1, __ATOMIC_ACQUIRE)) return epoch;
+
+    /* After an idle gap only the last ring's worth of periods matters */
+    from = w->current + 1 > epoch - w->slots + 1 ? w->current + 1 : epoch - w->slots + 1;
+    for(int64_t e = from; e <= epoch + 1; e++)
+    {
+        if(w->epochs[e % ring] == e) continue;
+        whist_clear(&w->hists[e % ring]);
+        __atomic_store_n(&w->epochs[e % ring], e, __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&w->current, epoch, __ATOMIC_RELEASE);
+    __atomic_store_n(&w->rotating, 0, __ATOMIC_RELEASE);
+    return epoch;
+}
+
+/* Function
+ *  create a windowed histogram, which means to allocate the underlying
+ *  structure. Release it with ctimer_free_whist().
+ *
+ *  @param tmp: the address of the histogram to be allocated
+ *  @param ck: clock enum, `cached` makes recording cheapest
+ *  @param period: nano-seconds covered by one sub-histogram
+ *  @param slots: number of periods in the longest window
+ *
+ *  @return: status code
+ */
+int ctimer_create_whist(ctimer_whist_t ** tmp, ctimer_clock_e ck, int64_t period, int slots)
+{
+    *tmp = NULL;
+    CHECK(period <= 0 || slots <= 0, "Invalid window of %d x %lld ns", slots,
+          (long long) period);
+    *tmp = (ctimer_whist_t *) calloc(1, sizeof(ctimer_whist_t));
+    CHECK(!*tmp, "Unable to create windowed histogram!");
+    (*tmp)->hists = (ctimer_hist_t *) malloc((slots + 1) * sizeof(ctimer_hist_t));
+    (*tmp)->epochs = (int64_t *) malloc((slots + 1) * sizeof(int64_t));
+    CHECK(!(*tmp)->hists || !(*tmp)->epochs, "Unable to create windowed histogram!");
+
+    CHECK(ck == CTIMER_TSC && ctimer_calibrate_tsc(CTIMER_TSC_CALIBRATE_MSEC),
+          "Unable to calibrate the tick counter!");
+    if(ck == CTIMER_CACHED) ctimer_cached_clock_ensure();
+
+    (*tmp)->clock = ck;
+    (*tmp)->period = period;
+    (*tmp)->slots = slots;
+    (*tmp)->begin = ctimer_get_clock_ns(ck);
+    for(int i = 0; i <= slots; i++)
+    {
+        ctimer_hist_reset(&(*tmp)->hists[i]);
+        (*tmp)->epochs[i] = i <= 1 ? i : -1;
+    }
+    return CTIMER_OK;
+
+error:
+    if(*tmp) ctimer_free_whist(*tmp);
+    *tmp = NULL;
+    return CTIMER_NOT_ALLOCATED;
+}
+
+/* Function
+ *  release a windowed histogram
+ *
+ *  @param w: the histogram
+ */
+void ctimer_free_whist(ctimer_whist_t * w)
+{
+    free(w->hists);
+    free(w->epochs);
+    free(w);
+}
+
+/* Function
+ *  record a value in the current period, safe to call from several threads.
+ *  The slot of the period is normally cleared ahead of time; only after an
+ *  idle gap does a recorder wait for the thread clearing it.
+ *
+ *  @param w: the histogram
+ *  @param value: the value, usually nano-seconds
+ */
+void ctimer_whist_record(ctimer_whist_t * w, int64_t value)
+{
+    int64_t now = ctimer_get_clock_ns(w->clock);
+    int64_t epoch = whist_advance(w, now);
+    int ring = w->slots + 1;
+
+    for(;;)
+    {
+        int64_t held = __atomic_load_n(&w->epochs[epoch % ring], __ATOMIC_ACQUIRE);
+        if(held == epoch) break;
+        /* A recorder that fell a whole ring behind counts for the current
+         * period, otherwise the slot is not published yet */
+        if(held > epoch) epoch = __atomic_load_n(&w->current, __ATOMIC_ACQUIRE);
+        else whist_advance(w, now);
+    }
+    ctimer_hist_record_atomic(&w->hists[epoch % ring], value);
+}
+
+/* Function
+ *  merge the values recorded over the last `window` nano-seconds, rounded
+ *  up to whole periods and limited to the number of slots
+ *
+ *  @param w: the histogram
+ *  @param window: length of the window in nano-seconds
+ *  @param out: receives the merged values
+ */
+void ctimer_whist_get(ctimer_whist_t * w, int64_t window, ctimer_hist_t * out)
+{
+    int64_t epoch = whist_advance(w, ctimer_get_clock_ns(w->clock));
+    int64_t periods = (window + w->period - 1) / w->period;
+    int ring = w->slots + 1;
+
+    if(periods > w->slots) periods = w->slots;
+    ctimer_hist_reset(out);
+    for(int64_t e = epoch - periods + 1; e <= epoch; e++)
+    {
+        if(e < 0) continue;
+        if(__atomic_load_n(&w->epochs[e % ring], __ATOMIC_ACQUIRE) != e) continue;
+        ctimer_hist_merge(out, &w->hists[e % ring]);
+    }
+}
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "timer_internal.h"
+
+/** Functions **/
+
+/* Function
+ *  drive a call open-loop: calls are scheduled at a fixed rate regardless of
+ *  how long earlier calls took. When a call overruns, the next ones are sent
+ *  as soon as possible and their latency is still measured from when they
+ *  should have been sent, which corrects for coordinated omission. The
+ *  uncorrected latency, measured from the actual send, is kept alongside.
+ *
+ *  @param cfg: the load configuration
+ *  @param fn: the call under test
+ *  @param arg: passed to every call
+ *  @param res: the results, histograms that are NULL get allocated
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_loadgen_run(ctimer_loadgen_t * cfg, ctimer_loadgen_fn fn, void * arg, ctimer_loadgen_result_t * res)
+{
+    int64_t begin, intended, sent, done = 0;
+    int ret;
+
+    CHECK(!cfg || !fn || !res, "Invalid load generator arguments!");
+    CHECK(cfg->rate <= 0.0, "Invalid rate %f", cfg->rate);
+    CHECK(cfg->calls <= 0, "Invalid number of calls %lld", (long long) cfg->calls);
+    CHECK(cfg->clock == CTIMER_CPUP || cfg->clock == CTIMER_CPUT,
+          "CPU-time clocks can not schedule calls!");
+
+    if(!res->corrected && (ret = ctimer_create_hist(&res->corrected)) != CTIMER_OK) return ret;
+    if(!res->uncorrected && (ret = ctimer_create_hist(&res->uncorrected)) != CTIMER_OK) return ret;
+    ctimer_hist_reset(res->corrected);
+    ctimer_hist_reset(res->uncorrected);
+    res->calls = res->errors = res->late = 0;
+
+    CHECK(cfg->clock == CTIMER_TSC && ctimer_calibrate_tsc(CTIMER_TSC_CALIBRATE_MSEC),
+          "Unable to calibrate the tick counter!");
+
+    begin = ctimer_get_clock_ns(cfg->clock);
+    for(int64_t i = 0; i < cfg->calls; i++)
+    {
+        intended = begin + (int64_t) ((double) i * CTIMER_NSEC_PER_SEC / cfg->rate);
+        if(ctimer_get_clock_ns(cfg->clock) > intended) res->late++;
+        else ctimer_wait_until(cfg->clock, intended);
+
+        sent = ctimer_get_clock_ns(cfg->clock);
+        if(fn(arg) != CTIMER_OK) res->errors++;
+        done = ctimer_get_clock_ns(cfg->clock);
+
+        ctimer_hist_record(res->corrected, done - intended);
+        ctimer_hist_record(res->uncorrected, done - sent);
+        res->calls++;
+    }
+    res->elapsed = done - begin;
+    return CTIMER_OK;
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  print the results of a load generator run
+ *
+ *  @param res: the results
+ *  @param ut: unit enum of the printed latencies
+ */
+void ctimer_print_loadgen(ctimer_loadgen_result_t * res, ctimer_unit_e ut)
+{
+    printf("Load: %lld calls in %.3f s (%.1f calls/s), %lld errors, %lld late\n",
+           (long long) res->calls, ctimer_ns_to_unit(res->elapsed, CTIMER_S),
+           res->elapsed ? res->calls / ctimer_ns_to_unit(res->elapsed, CTIMER_S) : 0.0,
+           (long long) res->errors, (long long) res->late);
+    ctimer_print_hist(res->corrected, "Latency (corrected)", ut);
+    ctimer_print_hist(res->uncorrected, "Latency (uncorrected)", ut);
+}
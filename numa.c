@@ -0,0 +1,101 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <dirent.h>
+
+#include "timer_internal.h"
+
+/** Functions **/
+
+/* Function
+ *  find the NUMA node of a CPU from sysfs, where every CPU directory links
+ *  to its node as nodeN
+ *
+ *  @param cpu: the CPU number
+ *
+ *  @return: the node number, 0 if the system has no NUMA information
+ */
+int ctimer_cpu_node(int cpu)
+{
+    char path[64];
+    struct dirent * entry;
+    DIR * dir;
+    int node = 0;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    if(!(dir = opendir(path))) return 0;
+    while((entry = readdir(dir)))
+        if(sscanf(entry->d_name, "node%d", &node) == 1) break;
+    closedir(dir);
+    return node;
+}
+
+/* Function
+ *  count the NUMA nodes of the system from sysfs
+ *
+ *  @return: the number of nodes, 1 if the system has no NUMA information
+ */
+int ctimer_numa_nodes(void)
+{
+    struct dirent * entry;
+    DIR * dir;
+    int node, nodes = 0;
+
+    if(!(dir = opendir("/sys/devices/system/node"))) return 1;
+    while((entry = readdir(dir)))
+        if(sscanf(entry->d_name, "node%d", &node) == 1 && node + 1 > nodes) nodes = node + 1;
+    closedir(dir);
+    return nodes > 0 ? nodes : 1;
+}
+
+/* Function
+ *  list the CPUs this process may run on in the order threads should be
+ *  placed on them. Compact placement fills one NUMA node before the next,
+ *  spread placement takes one CPU of every node in turn.
+ *
+ *  @param cpus: receives the CPU numbers
+ *  @param max: size of cpus
+ *  @param place: the placement
+ *
+ *  @return: the number of CPUs listed, or error status
+ */
+int ctimer_cpu_order(int * cpus, int max, ctimer_place_e place)
+{
+    cpu_set_t set;
+    int node[CPU_SETSIZE];
+    int count = 0, nodes = 0;
+
+    CHECK(sched_getaffinity(0, sizeof(set), &set), "Unable to get CPU affinity!");
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if(!CPU_ISSET(cpu, &set)) continue;
+        node[cpu] = ctimer_cpu_node(cpu);
+        if(node[cpu] + 1 > nodes) nodes = node[cpu] + 1;
+    }
+
+    /* Compact: node by node. Spread: the k-th CPU of every node, then the
+     * (k + 1)-th, ... */
+    for(int k = 0; count < max; k++)
+    {
+        int added = 0;
+        for(int n = 0; n < nodes && count < max; n++)
+        {
+            int seen = 0;
+            for(int cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++)
+            {
+                if(!CPU_ISSET(cpu, &set) || node[cpu] != n) continue;
+                if(place == CTIMER_PLACE_SPREAD && seen++ != k) continue;
+                cpus[count++] = cpu;
+                added++;
+            }
+        }
+        if(place != CTIMER_PLACE_SPREAD || !added) break;
+    }
+    return count;
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "timer_internal.h"
+
+/* Entry of the index of samples by parent */
+typedef struct
+{
+    uint32_t parent;
+    int64_t index;
+} path_child_t;
+
+/* State of a critical path search */
+typedef struct
+{
+    const ctimer_sample_t * samples;
+    path_child_t * children;
+    int64_t nchildren;
+    ctimer_path_t * path;
+} path_walk_t;
+
+/** Functions **/
+
+static int by_parent(const void * a, const void * b)
+{
+    uint32_t x = ((const path_child_t *) a)->parent, y = ((const path_child_t *) b)->parent;
+    return (x > y) - (x < y);
+}
+
+/* Function
+ *  internal function appending a segment, the segments are found from the
+ *  end of the path backwards
+ */
+static
+void path_add(path_walk_t * w, const ctimer_sample_t * s, int64_t start, int64_t stop)
+{
+    ctimer_path_t * path = w->path;
+
+    if(stop <= start) return;
+    if(path->nsegs == CTIMER_PATH_SEGMENTS)
+    {
+        path->truncated++;
+        return;
+    }
+    path->segs[path->nsegs].id = s->id;
+    path->segs[path->nsegs].name = s->name;
+    path->segs[path->nsegs].thread = s->thread;
+    path->segs[path->nsegs].start = start;
+    path->segs[path->nsegs].stop = stop;
+    path->nsegs++;
+}
+
+/* Function
+ *  internal function walking the critical path of a sample backwards from
+ *  `end`: the child that finished last before the current time determined
+ *  when the sample could go on, so the path follows it to its start; the
+ *  time no child covers is the sample's own.
+ */
+static
+void path_walk(path_walk_t * w, int64_t index, int64_t end, int depth)
+{
+    const ctimer_sample_t * s = &w->samples[index];
+    int64_t t = s->stop < end ? s->stop : end;
+    int64_t lo = 0, hi = w->nchildren;
+
+    /* Children of the sample are adjacent in the sorted index */
+    if(s->id && depth < CTIMER_PATH_SEGMENTS)
+    {
+        while(lo < hi)
+        {
+            int64_t mid = (lo + hi) / 2;
+            if(w->children[mid].parent < s->id) lo = mid + 1;
+            else hi = mid;
+        }
+        for(hi = lo; hi < w->nchildren && w->children[hi].parent == s->id; hi++);
+    }
+    else hi = lo;
+
+    while(t > s->start)
+    {
+        int64_t last = -1, last_end = INT64_MIN;
+
+        for(int64_t i = lo; i < hi; i++)
+        {
+            const ctimer_sample_t * c = &w->samples[w->children[i].index];
+            int64_t c_end = c->stop < t ? c->stop : t;
+            if(c->start < t && c_end > s->start && c_end > last_end)
+            {
+                last = w->children[i].index;
+                last_end = c_end;
+            }
+        }
+        if(last < 0) break;
+
+        path_add(w, s, last_end, t);
+        path_walk(w, last, last_end, depth + 1);
+        t = w->samples[last].start;
+    }
+    path_add(w, s, s->start, t);
+}
+
+/* Function
+ *  find the critical path of a sample: the chain of its descendants, linked
+ *  by their parent ids on any thread, that determined when it finished.
+ *  Every segment is a stretch of time one sample spent on the path itself,
+ *  while none of its children was; the segments cover the root sample from
+ *  start to stop.
+ *
+ *  @param samples: the samples, see ctimer_trace_collect()
+ *  @param n: number of samples
+ *  @param root: id of the sample whose path is wanted
+ *  @param path: the result
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_critical_path(const ctimer_sample_t * samples, int64_t n, uint32_t root, ctimer_path_t * path)
+{
+    path_walk_t w = {samples, NULL, 0, path};
+
+    memset(path, 0, sizeof(ctimer_path_t));
+    CHECK(root == 0, "The root sample needs an id!");
+    for(path->root = 0; path->root < n && samples[path->root].id != root; path->root++);
+    CHECK(path->root == n, "No sample with id %u", root);
+
+    w.children = (path_child_t *) malloc((n ? n : 1) * sizeof(path_child_t));
+    CHECK(!w.children, "Unable to allocate the child index!");
+    for(int64_t i = 0; i < n; i++)
+    {
+        if(!samples[i].parent) continue;
+        w.children[w.nchildren].parent = samples[i].parent;
+        w.children[w.nchildren++].index = i;
+    }
+    qsort(w.children, w.nchildren, sizeof(path_child_t), by_parent);
+
+    path_walk(&w, path->root, samples[path->root].stop, 0);
+    free(w.children);
+
+    /* Found from the end backwards */
+    for(int i = 0; i < path->nsegs / 2; i++)
+    {
+        ctimer_segment_t seg = path->segs[i];
+        path->segs[i] = path->segs[path->nsegs - 1 - i];
+        path->segs[path->nsegs - 1 - i] = seg;
+    }
+    return CTIMER_OK;
+
+error:
+    return CTIMER_CALL_FAILED;
+}
+
+/* Function
+ *  print a critical path: its segments in the order of time and how much
+ *  every name contributed to it
+ *
+ *  @param path: the path
+ *  @param samples: the samples it was found in
+ *  @param names: the name table, e.g. of the trace
+ *  @param nnames: number of names in the table, ids beyond print as "?"
+ *  @param ut: unit enum of the printed times
+ */
+void ctimer_print_path(ctimer_path_t * path, const ctimer_sample_t * samples, char ** names, int nnames,
+                       ctimer_unit_e ut)
+{
+    const ctimer_sample_t * root = &samples[path->root];
+    int64_t total = root->stop - root->start;
+    int64_t by_name[CTIMER_TRACE_NAMES] = {0};
+    char * unit = ctimer_print_unit(ut);
+
+    if(nnames > CTIMER_TRACE_NAMES) nnames = CTIMER_TRACE_NAMES;
+    printf("Critical path of %s: %.3f %s in %d segments\n",
+           root->name < (uint32_t) nnames ? names[root->name] : "?",
+           ctimer_ns_to_unit(total, ut), unit, path->nsegs);
+    for(int i = 0; i < path->nsegs; i++)
+    {
+        ctimer_segment_t * seg = &path->segs[i];
+        printf("  +%.3f %s: %s (id %u, thread %u) for %.3f %s\n",
+               ctimer_ns_to_unit(seg->start - root->start, ut), unit,
+               seg->name < (uint32_t) nnames ? names[seg->name] : "?", seg->id,
+               seg->thread, ctimer_ns_to_unit(seg->stop - seg->start, ut), unit);
+        if(seg->name < (uint32_t) nnames) by_name[seg->name] += seg->stop - seg->start;
+    }
+    for(int n = 0; n < nnames; n++)
+        if(by_name[n])
+            printf("  %s: %.3f %s, %.1f%% of the path\n", names[n], ctimer_ns_to_unit(by_name[n], ut), unit,
+                   total > 0 ? 100.0 * by_name[n] / total : 0.0);
+    if(path->truncated) printf("  %lld segments dropped\n", (long long) path->truncated);
+}
@@ -0,0 +1,228 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ctimer.h"
+
+#ifndef PROBE_STEPS
+/* Dependent loads per latency measurement */
+#define PROBE_STEPS (1 << 20)
+#endif
+
+#ifndef PROBE_TRIALS
+/* Runs of every bandwidth kernel, the best one is reported */
+#define PROBE_TRIALS 10
+#endif
+
+#ifndef PROBE_MAX_BYTES
+/* Upper bound of the latency working set and of one bandwidth array */
+#define PROBE_MAX_BYTES (512L << 20)
+#endif
+
+/* One pointer per cache line */
+#define LINE 64
+#define SLOTS (LINE / sizeof(size_t))
+
+/* Pointer chasing state, the chain is rebuilt when n changes */
+typedef struct
+{
+    size_t * chain;
+    int64_t n;
+    size_t sink;
+} chase_t;
+
+static const char * levels[] = {"L1", "L2", "L3"};
+
+/* Size in bytes of the data cache of a level, 0 if unknown */
+static long cache_size(int level)
+{
+    char path[128], type[32];
+    long size = 0;
+
+    for(int i = 0; i < 8; i++)
+    {
+        FILE * f;
+        int lvl = 0;
+        char unit = 'B';
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", i);
+        if(!(f = fopen(path, "r"))) break;
+        if(fscanf(f, "%d", &lvl) != 1) lvl = 0;
+        fclose(f);
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", i);
+        if(!(f = fopen(path, "r"))) continue;
+        if(fscanf(f, "%31s", type) != 1) type[0] = '\0';
+        fclose(f);
+        if(lvl != level || !strcmp(type, "Instruction")) continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+        if(!(f = fopen(path, "r"))) continue;
+        if(fscanf(f, "%ld%c", &size, &unit) < 1) size = 0;
+        fclose(f);
+        if(unit == 'K') size <<= 10;
+        else if(unit == 'M') size <<= 20;
+    }
+    return size;
+}
+
+/* Links the cache lines of n bytes into one random cycle (Sattolo's
+ * algorithm), so hardware prefetchers can not predict the next load */
+static void build_chain(chase_t * c, int64_t n)
+{
+    size_t lines = n / LINE;
+    size_t * order = (size_t *) malloc(lines * sizeof(size_t));
+    unsigned int seed = 1;
+
+    for(size_t i = 0; i < lines; i++)
+        order[i] = i;
+    for(size_t i = lines - 1; i > 0; i--)
+    {
+        size_t j = (((size_t) rand_r(&seed) << 31) | rand_r(&seed)) % i;
+        size_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for(size_t i = 0; i < lines; i++)
+        c->chain[order[i] * SLOTS] = order[(i + 1) % lines] * SLOTS;
+    free(order);
+    c->n = n;
+}
+
+/* Follows the chain for PROBE_STEPS loads, building it on the first
+ * (warm-up) run of every size */
+static int chase(void * arg, int64_t n)
+{
+    chase_t * c = (chase_t *) arg;
+    size_t p = 0;
+
+    if(c->n != n) build_chain(c, n);
+    for(int i = 0; i < PROBE_STEPS; i++)
+        p = c->chain[p];
+    c->sink += p;
+    return CTIMER_OK;
+}
+
+/* Runs one STREAM kernel PROBE_TRIALS times, prints the best and average
+ * bandwidth */
+static void stream(char * name, int kernel, double * a, double * b, double * c, long n, int arrays)
+{
+    ctimer_interval_t * iv;
+    int64_t best = INT64_MAX, total = 0;
+    double bytes = (double) arrays * n * sizeof(double);
+
+    ctimer_create_interval(&iv, name, CTIMER_MONO, CTIMER_NS);
+    for(int t = 0; t < PROBE_TRIALS; t++)
+    {
+        ctimer_start(iv);
+        switch(kernel)
+        {
+            case 0:
+                for(long i = 0; i < n; i++) c[i] = a[i];
+                break;
+            case 1:
+                for(long i = 0; i < n; i++) b[i] = 3.0 * c[i];
+                break;
+            case 2:
+                for(long i = 0; i < n; i++) c[i] = a[i] + b[i];
+                break;
+            default:
+                for(long i = 0; i < n; i++) a[i] = b[i] + 3.0 * c[i];
+                break;
+        }
+        ctimer_stop(iv);
+
+        int64_t ns = ctimer_elapsed_interval_ns(iv);
+        total += ns;
+        if(ns < best) best = ns;
+    }
+    printf("%s, %.1f, %.1f\n", name, bytes / ctimer_ns_to_unit(best, CTIMER_US),
+           bytes / ctimer_ns_to_unit(total / PROBE_TRIALS, CTIMER_US));
+    free(iv);
+}
+
+int main()
+{
+    long caches[3];
+    char model[256] = "unknown";
+    char line[512];
+    FILE * f;
+
+    printf("# Machine profile\n");
+    if((f = fopen("/proc/cpuinfo", "r")))
+    {
+        while(fgets(line, sizeof(line), f))
+        {
+            char * colon = strchr(line, ':');
+            if(strncmp(line, "model name", 10) || !colon) continue;
+            snprintf(model, sizeof(model), "%s", colon + 2);
+            model[strcspn(model, "\n")] = '\0';
+            break;
+        }
+        fclose(f);
+    }
+    printf("cpu: %s\n", model);
+    printf("cpus: %ld\n", sysconf(_SC_NPROCESSORS_ONLN));
+    for(int l = 0; l < 3; l++)
+    {
+        caches[l] = cache_size(l + 1);
+        printf("%s: %ld KiB\n", levels[l], caches[l] >> 10);
+    }
+
+    /* Latency: working sets from 4 KiB to four times the last level cache */
+    long largest = caches[2] ? caches[2] : caches[1] ? caches[1] : 1L << 20;
+    int64_t top = 1 << 12;
+    while(top < 4 * largest && top < PROBE_MAX_BYTES) top <<= 1;
+
+    chase_t c = {NULL, 0, 0};
+    c.chain = (size_t *) malloc(top);
+    if(!c.chain) return EXIT_FAILURE;
+    ctimer_sweep_t sw = {1 << 12, top, 2, 0, 3, CTIMER_MONO};
+    ctimer_sweep_result_t res;
+    if(ctimer_sweep_run(&sw, chase, &c, &res) != CTIMER_OK) return EXIT_FAILURE;
+    free(c.chain);
+
+    printf("# Load latency\n");
+    printf("# working set (KiB), latency (ns)\n");
+    for(int i = 0; i < res.points; i++)
+        printf("%lld, %.2f\n", (long long) res.n[i] >> 10, (double) res.min[i] / PROBE_STEPS);
+
+    /* Per level, the largest working set that fits into half of it */
+    for(int l = 0; l < 3; l++)
+    {
+        int pick = -1;
+        for(int i = 0; i < res.points; i++)
+            if(res.n[i] <= caches[l] / 2) pick = i;
+        if(pick >= 0)
+            printf("%s latency: %.2f ns\n", levels[l], (double) res.min[pick] / PROBE_STEPS);
+    }
+    printf("DRAM latency: %.2f ns\n", (double) res.min[res.points - 1] / PROBE_STEPS);
+
+    /* Bandwidth: STREAM kernels on arrays of four times the last level
+     * cache */
+    long n = (4 * largest < PROBE_MAX_BYTES ? 4 * largest : PROBE_MAX_BYTES) / sizeof(double);
+    double * a = (double *) malloc(n * sizeof(double));
+    double * b = (double *) malloc(n * sizeof(double));
+    double * d = (double *) malloc(n * sizeof(double));
+    if(!a || !b || !d) return EXIT_FAILURE;
+    for(long i = 0; i < n; i++)
+    {
+        a[i] = 1.0;
+        b[i] = 2.0;
+        d[i] = 0.0;
+    }
+
+    printf("# Bandwidth, %ld doubles per array\n", n);
+    printf("# kernel, best (MB/s), average (MB/s)\n");
+    stream("copy", 0, a, b, d, n, 2);
+    stream("scale", 1, a, b, d, n, 2);
+    stream("add", 2, a, b, d, n, 3);
+    stream("triad", 3, a, b, d, n, 3);
+    CTIMER_DO_NOT_OPTIMIZE(c.sink);
+    CTIMER_DO_NOT_OPTIMIZE(a[n / 2]);
+
+    free(a);
+    free(b);
+    free(d);
+    return EXIT_SUCCESS;
+}
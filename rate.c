@@ -0,0 +1,186 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "timer_internal.h"
+
+/* Number of one-second snapshots kept, one more than the longest window */
+#define RATE_SNAPS (CTIMER_RATE_WINDOW + 1)
+
+static const int rate_secs[CTIMER_RATE_WINDOWS] = CTIMER_RATE_WINDOW_SECS;
+
+/** Functions **/
+
+/* Function
+ *  internal function that accounts for the seconds that passed since the
+ *  last call: it snapshots the totals and updates the moving averages.
+ *  Only one thread does this at a time, the others skip it, so writers
+ *  never wait on each other.
+ */
+static
+void rate_advance(ctimer_rate_t * m, int64_t now)
+{
+    int64_t sec = (now - m->begin) / CTIMER_NSEC_PER_SEC;
+    int64_t first, events, bytes;
+    double de, db;
+
+    if(sec <= __atomic_load_n(&m->tick, __ATOMIC_ACQUIRE)) return;
+    if(__atomic_exchange_n(&m->ticking, 1, __ATOMIC_ACQUIRE)) return;
+
+    /* Everything since the last snapshot counts for the first second that
+     * ended, the seconds after it were idle and only decay the averages,
+     * which is done in one step however long the gap. */
+    first = m->tick + 1;
+    events = __atomic_load_n(&m->events, __ATOMIC_RELAXED);
+    bytes = __atomic_load_n(&m->bytes, __ATOMIC_RELAXED);
+    de = (double) (events - m->snap_events[m->tick % RATE_SNAPS]);
+    db = (double) (bytes - m->snap_bytes[m->tick % RATE_SNAPS]);
+    for(int w = 0; w < CTIMER_RATE_WINDOWS; w++)
+    {
+        double alpha = first == 1 ? 1.0 : 1.0 - exp(-1.0 / rate_secs[w]);
+        double decay = exp(-(double) (sec - first) / rate_secs[w]);
+        m->ewma_events[w] = (m->ewma_events[w] + alpha * (de - m->ewma_events[w])) * decay;
+        m->ewma_bytes[w] = (m->ewma_bytes[w] + alpha * (db - m->ewma_bytes[w])) * decay;
+    }
+    for(int64_t t = sec - first < RATE_SNAPS ? first : sec - RATE_SNAPS + 1; t <= sec; t++)
+    {
+        m->snap_events[t % RATE_SNAPS] = events;
+        m->snap_bytes[t % RATE_SNAPS] = bytes;
+    }
+
+    __atomic_store_n(&m->tick, sec, __ATOMIC_RELEASE);
+    __atomic_store_n(&m->ticking, 0, __ATOMIC_RELEASE);
+}
+
+/* Function
+ *  create a rate meter, which means to allocate the underlying structure.
+ *  Release it with free().
+ *
+ *  @param tmp: the address of the meter to be allocated
+ *  @param ck: clock enum, `cached` makes marking cheapest
+ *
+ *  @return: status code
+ */
+int ctimer_create_rate(ctimer_rate_t ** tmp, ctimer_clock_e ck)
+{
+    *tmp = (ctimer_rate_t *) malloc(sizeof(ctimer_rate_t));
+    CHECK(!*tmp, "Unable to create rate meter!");
+    CHECK(ck == CTIMER_TSC && ctimer_calibrate_tsc(CTIMER_TSC_CALIBRATE_MSEC),
+          "Unable to calibrate the tick counter!");
+    if(ck == CTIMER_CACHED) ctimer_cached_clock_ensure();
+    (*tmp)->clock = ck;
+    ctimer_rate_reset(*tmp);
+    return CTIMER_OK;
+
+error:
+    free(*tmp);
+    *tmp = NULL;
+    return CTIMER_NOT_ALLOCATED;
+}
+
+/* Function
+ *  clear a rate meter and restart its windows now, must not race with
+ *  writers
+ *
+ *  @param m: the meter
+ */
+void ctimer_rate_reset(ctimer_rate_t * m)
+{
+    ctimer_clock_e ck = m->clock;
+    memset(m, 0, sizeof(ctimer_rate_t));
+    m->clock = ck;
+    m->begin = ctimer_get_clock_ns(ck);
+}
+
+/* Function
+ *  count events and bytes, this may be called from any number of threads
+ *
+ *  @param m: the meter
+ *  @param events: number of events, e.g. operations
+ *  @param bytes: number of bytes processed by them
+ */
+void ctimer_rate_mark(ctimer_rate_t * m, int64_t events, int64_t bytes)
+{
+    __atomic_fetch_add(&m->events, events, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&m->bytes, bytes, __ATOMIC_RELAXED);
+    rate_advance(m, ctimer_get_clock_ns(m->clock));
+}
+
+/* Function
+ *  compute the current rates of a meter, the averages and snapshots are
+ *  copied while holding off the thread accounting for new seconds
+ *
+ *  @param m: the meter
+ *  @param rep: the snapshot to be filled in
+ */
+void ctimer_rate_get(ctimer_rate_t * m, ctimer_rate_report_t * rep)
+{
+    int64_t now = ctimer_get_clock_ns(m->clock);
+    int64_t snap_events[CTIMER_RATE_WINDOWS], snap_bytes[CTIMER_RATE_WINDOWS];
+    int64_t tick;
+
+    rate_advance(m, now);
+    while(__atomic_exchange_n(&m->ticking, 1, __ATOMIC_ACQUIRE));
+    tick = m->tick;
+    for(int w = 0; w < CTIMER_RATE_WINDOWS; w++)
+    {
+        int64_t from = tick > rate_secs[w] ? tick - rate_secs[w] : 0;
+        snap_events[w] = m->snap_events[from % RATE_SNAPS];
+        snap_bytes[w] = m->snap_bytes[from % RATE_SNAPS];
+        rep->ewma_events[w] = m->ewma_events[w];
+        rep->ewma_bytes[w] = m->ewma_bytes[w];
+    }
+    __atomic_store_n(&m->ticking, 0, __ATOMIC_RELEASE);
+
+    rep->events = __atomic_load_n(&m->events, __ATOMIC_RELAXED);
+    rep->bytes = __atomic_load_n(&m->bytes, __ATOMIC_RELAXED);
+    rep->elapsed = now - m->begin;
+    rep->mean_events = rep->elapsed > 0 ? rep->events / ctimer_ns_to_unit(rep->elapsed, CTIMER_S) : 0.0;
+    rep->mean_bytes = rep->elapsed > 0 ? rep->bytes / ctimer_ns_to_unit(rep->elapsed, CTIMER_S) : 0.0;
+
+    for(int w = 0; w < CTIMER_RATE_WINDOWS; w++)
+    {
+        /* The window starts at the snapshot rate_secs[w] seconds ago */
+        int64_t from = tick > rate_secs[w] ? tick - rate_secs[w] : 0;
+        int64_t span = now - (m->begin + from * CTIMER_NSEC_PER_SEC);
+
+        rep->window_events[w] = span > 0 ?
+            (rep->events - snap_events[w]) / ctimer_ns_to_unit(span, CTIMER_S) : 0.0;
+        rep->window_bytes[w] = span > 0 ?
+            (rep->bytes - snap_bytes[w]) / ctimer_ns_to_unit(span, CTIMER_S) : 0.0;
+    }
+}
+
+/* Function
+ *  print the totals and rates of a meter
+ *
+ *  @param m: the meter
+ *  @param name: printed in front of the rates
+ */
+void ctimer_print_rate(ctimer_rate_t * m, char * name)
+{
+    ctimer_rate_report_t rep;
+
+    ctimer_rate_get(m, &rep);
+    printf("%s: %lld ops, %lld B in %.3f s, mean %.1f ops/s, %.1f B/s\n", name,
+           (long long) rep.events, (long long) rep.bytes, ctimer_ns_to_unit(rep.elapsed, CTIMER_S),
+           rep.mean_events, rep.mean_bytes);
+    for(int w = 0; w < CTIMER_RATE_WINDOWS; w++)
+        printf("%s (%ds): ewma %.1f ops/s, %.1f B/s, window %.1f ops/s, %.1f B/s\n",
+               name, rate_secs[w], rep.ewma_events[w], rep.ewma_bytes[w],
+               rep.window_events[w], rep.window_bytes[w]);
+}
+
+/* Function
+ *  attach a rate meter to an interval, ctimer_print_results() then reports the
+ *  meter totals over the elapsed time of the interval
+ *
+ *  @param tmp: the interval
+ *  @param m: the meter, or NULL to detach
+ */
+void ctimer_attach_rate(ctimer_interval_t * tmp, ctimer_rate_t * m)
+{
+    tmp->rate = m;
+}
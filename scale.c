@@ -0,0 +1,194 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "timer_internal.h"
+
+/* Start gate the workers wait at until all of them exist, open is -1 if
+ * the run was abandoned */
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int open;
+} scale_gate_t;
+
+/* State of one worker thread */
+typedef struct
+{
+    ctimer_scale_fn fn;
+    void * arg;
+    int thread;
+    int64_t ops;
+    int64_t errors;
+    scale_gate_t * gate;
+    ctimer_interval_t * iv;
+} scale_worker_t;
+
+/** Functions **/
+
+/* Function
+ *  internal worker thread, waits for all others and then runs its share of
+ *  operations inside its own interval
+ */
+static
+void * scale_worker(void * arg)
+{
+    scale_worker_t * w = (scale_worker_t *) arg;
+    int open;
+
+    pthread_mutex_lock(&w->gate->lock);
+    while(!w->gate->open)
+        pthread_cond_wait(&w->gate->cond, &w->gate->lock);
+    open = w->gate->open;
+    pthread_mutex_unlock(&w->gate->lock);
+    if(open < 0) return NULL;
+
+    ctimer_start(w->iv);
+    for(int64_t i = 0; i < w->ops; i++)
+        if(w->fn(w->arg, w->thread) != CTIMER_OK) w->errors++;
+    ctimer_stop(w->iv);
+    return NULL;
+}
+
+/* Function
+ *  internal function running the operations on the given number of threads
+ *  and filling in one point of the results
+ */
+static
+int scale_point(ctimer_scale_t * cfg, ctimer_scale_fn fn, void * arg, int threads,
+                int * cpus, int ncpus, ctimer_scale_result_t * res)
+{
+    scale_worker_t workers[threads];
+    pthread_t ids[threads];
+    scale_gate_t gate = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0};
+    int64_t first = INT64_MAX, last = INT64_MIN, fastest = INT64_MAX, slowest = 0;
+    int started = 0;
+    int p = res->points;
+
+    memset(workers, 0, sizeof(workers));
+    for(int t = 0; t < threads; t++)
+    {
+        pthread_attr_t attr;
+        cpu_set_t set;
+
+        workers[t].fn = fn;
+        workers[t].arg = arg;
+        workers[t].thread = t;
+        workers[t].ops = cfg->ops;
+        workers[t].gate = &gate;
+        if(ctimer_create_interval(&workers[t].iv, "thread", cfg->clock, CTIMER_NS) != CTIMER_OK) break;
+
+        pthread_attr_init(&attr);
+        if(ncpus > 0)
+        {
+            CPU_ZERO(&set);
+            CPU_SET(cpus[t % ncpus], &set);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        }
+        if(pthread_create(&ids[t], &attr, scale_worker, &workers[t]))
+        {
+            ERROR("Unable to start thread %d of %d", t, threads);
+            pthread_attr_destroy(&attr);
+            break;
+        }
+        pthread_attr_destroy(&attr);
+        started++;
+    }
+
+    /* Open the gate, or send the started threads home if not all exist */
+    pthread_mutex_lock(&gate.lock);
+    gate.open = started == threads ? 1 : -1;
+    pthread_cond_broadcast(&gate.cond);
+    pthread_mutex_unlock(&gate.lock);
+
+    for(int t = 0; t < started; t++)
+    {
+        pthread_join(ids[t], NULL);
+        int64_t begin = ctimer_timespec_to_ns(workers[t].iv->start);
+        int64_t end = ctimer_timespec_to_ns(workers[t].iv->stop);
+        if(begin < first) first = begin;
+        if(end > last) last = end;
+        if(end - begin < fastest) fastest = end - begin;
+        if(end - begin > slowest) slowest = end - begin;
+        res->errors += workers[t].errors;
+    }
+    for(int t = 0; t < threads; t++)
+        free(workers[t].iv);
+    if(started < threads) return CTIMER_NOT_ALLOCATED;
+
+    res->threads[p] = threads;
+    res->elapsed[p] = last - first;
+    res->throughput[p] = last > first ? threads * cfg->ops / ctimer_ns_to_unit(last - first, CTIMER_S) : 0.0;
+    res->speedup[p] = res->throughput[0] > 0.0 ? res->throughput[p] / res->throughput[0] : 0.0;
+    res->efficiency[p] = res->speedup[p] / threads;
+    res->imbalance[p] = fastest > 0 ? (double) slowest / fastest : 0.0;
+    res->points++;
+    return CTIMER_OK;
+}
+
+/* Function
+ *  measure how the throughput of an operation scales with threads. For
+ *  every thread count all threads are released together from a gate and
+ *  each runs `ops` operations in its own interval; the throughput counts
+ *  from the first start to the last stop.
+ *
+ *  @param cfg: the run configuration
+ *  @param fn: the operation, must be safe to call from several threads
+ *  @param arg: passed to every call
+ *  @param res: the results
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_scale_run(ctimer_scale_t * cfg, ctimer_scale_fn fn, void * arg, ctimer_scale_result_t * res)
+{
+    int cpus[CTIMER_MAX_THREADS];
+    int ncpus = 0;
+    int ret;
+
+    CHECK(!cfg || !fn || !res, "Invalid scalability arguments!");
+    CHECK(cfg->max_threads < 1 || cfg->max_threads > CTIMER_MAX_THREADS,
+          "Invalid number of threads %d", cfg->max_threads);
+    CHECK(cfg->ops <= 0, "Invalid number of operations %lld", (long long) cfg->ops);
+    CHECK(cfg->clock == CTIMER_CPUP || cfg->clock == CTIMER_CPUT,
+          "CPU-time clocks can not measure throughput!");
+
+    memset(res, 0, sizeof(ctimer_scale_result_t));
+    CHECK(cfg->clock == CTIMER_TSC && ctimer_calibrate_tsc(CTIMER_TSC_CALIBRATE_MSEC),
+          "Unable to calibrate the tick counter!");
+    if(cfg->place != CTIMER_PLACE_NONE)
+    {
+        ncpus = ctimer_cpu_order(cpus, CTIMER_MAX_THREADS, cfg->place);
+        if(ncpus < 0) return ncpus;
+    }
+
+    for(int threads = 1; ; threads = threads * 2 < cfg->max_threads ? threads * 2 : cfg->max_threads)
+    {
+        ret = scale_point(cfg, fn, arg, threads, cpus, ncpus, res);
+        if(ret != CTIMER_OK) return ret;
+        if(threads == cfg->max_threads) break;
+    }
+    return CTIMER_OK;
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  print the results of a scalability run
+ *
+ *  @param res: the results
+ *  @param name: printed in front of every thread count
+ */
+void ctimer_print_scale(ctimer_scale_result_t * res, char * name)
+{
+    for(int i = 0; i < res->points; i++)
+        printf("%s %d threads: %.1f ops/s in %.3f ms, speedup %.2f, efficiency %.0f%%, imbalance %.2f\n",
+               name, res->threads[i], res->throughput[i], ctimer_ns_to_unit(res->elapsed[i], CTIMER_MS),
+               res->speedup[i], 100.0 * res->efficiency[i], res->imbalance[i]);
+    if(res->errors) printf("%s: %lld errors\n", name, (long long) res->errors);
+}
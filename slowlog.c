@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "timer_internal.h"
+
+/** Globals **/
+
+/* Intervals started with ctimer_slow_start() and not stopped yet, on this
+ * thread; depth counts those beyond CTIMER_SCOPE_DEPTH too */
+static __thread ctimer_interval_t * scopes[CTIMER_SCOPE_DEPTH];
+static __thread int depth = 0;
+static __thread uint32_t local_tid = 0;
+
+/** Functions **/
+
+/* Function
+ *  create a slow-log, which means to allocate the underlying structure.
+ *  Release it with free().
+ *
+ *  @param tmp: the address of the slow-log to be allocated
+ *  @param threshold: nano-seconds above which intervals are captured
+ *
+ *  @return: status code
+ */
+int ctimer_create_slowlog(ctimer_slowlog_t ** tmp, int64_t threshold)
+{
+    *tmp = (ctimer_slowlog_t *) calloc(1, sizeof(ctimer_slowlog_t));
+    CHECK(!*tmp, "Unable to create slow-log!");
+    (*tmp)->threshold = threshold;
+    return CTIMER_OK;
+
+error:
+    return CTIMER_NOT_ALLOCATED;
+}
+
+/* Function
+ *  change the threshold of a slow-log, safe while other threads stop
+ *  intervals
+ *
+ *  @param log: the slow-log
+ *  @param threshold: nano-seconds above which intervals are captured
+ */
+void ctimer_slowlog_threshold(ctimer_slowlog_t * log, int64_t threshold)
+{
+    __atomic_store_n(&log->threshold, threshold, __ATOMIC_RELAXED);
+}
+
+/* Function
+ *  set the threshold of a slow-log to a percentile of a histogram, e.g. the
+ *  p99 of a windowed histogram the intervals are recorded into. Calling
+ *  this now and then keeps the threshold at the current tail, while
+ *  stopping an interval still costs just one comparison.
+ *
+ *  @param log: the slow-log
+ *  @param h: the histogram
+ *  @param p: the percentile, between 0 and 100
+ */
+void ctimer_slowlog_adapt(ctimer_slowlog_t * log, ctimer_hist_t * h, double p)
+{
+    if(h->count) ctimer_slowlog_threshold(log, ctimer_hist_percentile(h, p));
+}
+
+/* Function
+ *  start an interval as a scope of the calling thread, so that slow
+ *  intervals stopped inside it name it as an enclosing scope
+ *
+ *  @param tmp: the interval
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_slow_start(ctimer_interval_t * tmp)
+{
+    if(depth < CTIMER_SCOPE_DEPTH) scopes[depth] = tmp;
+    depth++;
+    return ctimer_start(tmp);
+}
+
+/* Function
+ *  internal function copying a slow interval and its enclosing scopes into
+ *  the log, outside the fast path of ctimer_slow_stop()
+ */
+static __attribute__((noinline))
+void slowlog_capture(ctimer_slowlog_t * log, ctimer_interval_t * tmp)
+{
+    ctimer_slow_t * e;
+
+    if(!local_tid) local_tid = (uint32_t) syscall(SYS_gettid);
+    while(__atomic_exchange_n(&log->lock, 1, __ATOMIC_ACQUIRE));
+    e = &log->entries[log->captured % CTIMER_SLOW_ENTRIES];
+    e->name = tmp->name;
+    e->clock = tmp->clock;
+    e->start = ctimer_timespec_to_ns(tmp->start);
+    e->stop = ctimer_timespec_to_ns(tmp->stop);
+    e->thread = local_tid;
+    e->depth = depth;
+    for(int i = 0; i < depth && i < CTIMER_SCOPE_DEPTH; i++)
+        e->scopes[i] = scopes[i]->name;
+    log->captured++;
+    __atomic_store_n(&log->lock, 0, __ATOMIC_RELEASE);
+}
+
+/* Function
+ *  stop an interval started with ctimer_slow_start() and capture it in the
+ *  slow-log if it took longer than the threshold. Intervals below the
+ *  threshold cost one comparison on top of ctimer_stop().
+ *
+ *  @param log: the slow-log
+ *  @param tmp: the interval, the innermost open scope of the thread
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_slow_stop(ctimer_slowlog_t * log, ctimer_interval_t * tmp)
+{
+    int ret = ctimer_stop(tmp);
+
+    if(depth > 0) depth--;
+    if(ret == CTIMER_OK &&
+       __builtin_expect(ctimer_elapsed_interval_ns(tmp) > __atomic_load_n(&log->threshold, __ATOMIC_RELAXED), 0))
+        slowlog_capture(log, tmp);
+    return ret;
+}
+
+/* Function
+ *  print the captured intervals of a slow-log, oldest first, each with its
+ *  start time in UTC and its enclosing scopes. The captures are recent, so
+ *  one paired reading per clock, taken now, maps them to wall time; CPU
+ *  times stay raw. This must not race with threads capturing.
+ *
+ *  @param log: the slow-log
+ *  @param ut: unit enum of the printed lengths
+ */
+void ctimer_print_slowlog(ctimer_slowlog_t * log, ctimer_unit_e ut)
+{
+    int64_t first = log->captured > CTIMER_SLOW_ENTRIES ? log->captured - CTIMER_SLOW_ENTRIES : 0;
+    char * unit = ctimer_print_unit(ut);
+    ctimer_epoch_t epochs[CTIMER_CACHED + 1];
+    int mapped[CTIMER_CACHED + 1] = {0};
+
+    printf("Slow-log: %lld intervals above %.3f %s\n", (long long) log->captured,
+           ctimer_ns_to_unit(log->threshold, ut), unit);
+    for(int64_t i = first; i < log->captured; i++)
+    {
+        ctimer_slow_t * e = &log->entries[i % CTIMER_SLOW_ENTRIES];
+        char at[64];
+
+        /* 1 once the clock is mapped, -1 if it can not be */
+        if(!mapped[e->clock])
+            mapped[e->clock] = e->clock != CTIMER_CPUP && e->clock != CTIMER_CPUT &&
+                               ctimer_epoch_init(&epochs[e->clock], e->clock) == CTIMER_OK ? 1 : -1;
+        if(mapped[e->clock] < 0 ||
+           ctimer_format_utc(ctimer_epoch_to_realtime(&epochs[e->clock], e->start), at, sizeof(at)))
+            snprintf(at, sizeof(at), "%lld", (long long) e->start);
+        printf("  %s: %.3f %s at %s on thread %u", e->name, ctimer_ns_to_unit(e->stop - e->start, ut), unit,
+               at, e->thread);
+        if(e->depth) printf(", in");
+        for(int d = 0; d < e->depth && d < CTIMER_SCOPE_DEPTH; d++)
+            printf(" %s%s", e->scopes[d], d + 1 < e->depth ? " >" : "");
+        if(e->depth > CTIMER_SCOPE_DEPTH) printf(" ...");
+        printf("\n");
+    }
+}
@@ -0,0 +1,212 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "timer_internal.h"
+
+/** Functions **/
+
+/* Function
+ *  internal function evaluating a complexity curve at n
+ */
+static inline
+double big_o_curve(ctimer_big_o_e fit, int64_t n)
+{
+    double x = (double) n;
+
+    switch(fit)
+    {
+        case CTIMER_OLOGN:
+            return log2(x);
+        case CTIMER_ON:
+            return x;
+        case CTIMER_ONLOGN:
+            return x * log2(x);
+        case CTIMER_ON2:
+            return x * x;
+        case CTIMER_ON3:
+            return x * x * x;
+        default:
+            return 1.0;
+    }
+}
+
+/* Function
+ *  internal function that fits every complexity curve to the mean times by
+ *  least squares, time = coef * f(n), and picks the one with the smallest
+ *  error
+ */
+static
+void sweep_fit(ctimer_sweep_result_t * res)
+{
+    double average = 0.0;
+
+    for(int i = 0; i < res->points; i++)
+        average += (double) res->mean[i] / res->points;
+
+    res->best = CTIMER_O1;
+    for(int f = 0; f < CTIMER_FITS; f++)
+    {
+        double tf = 0.0, ff = 0.0, err = 0.0;
+
+        for(int i = 0; i < res->points; i++)
+        {
+            double g = big_o_curve((ctimer_big_o_e) f, res->n[i]);
+            tf += (double) res->mean[i] * g;
+            ff += g * g;
+        }
+        res->coef[f] = ff > 0.0 ? tf / ff : 0.0;
+
+        for(int i = 0; i < res->points; i++)
+        {
+            double d = (double) res->mean[i] - res->coef[f] * big_o_curve((ctimer_big_o_e) f, res->n[i]);
+            err += d * d;
+        }
+        res->rms[f] = average > 0.0 ? sqrt(err / res->points) / average : 0.0;
+        if(res->rms[f] < res->rms[res->best]) res->best = (ctimer_big_o_e) f;
+    }
+}
+
+/* Function
+ *  internal function returning the point after n, or 0 past the end of the
+ *  range; this is checked before stepping, which could overflow near
+ *  INT64_MAX
+ */
+static inline
+int64_t sweep_next(ctimer_sweep_t * cfg, int64_t n)
+{
+    if(cfg->mult > 1) return n > cfg->to / cfg->mult ? 0 : n * cfg->mult;
+    return n > cfg->to - cfg->step ? 0 : n + cfg->step;
+}
+
+/* Function
+ *  run a benchmark over a range of its parameter n. Every point is measured
+ *  `repeats` times with its own interval, after one unmeasured warm-up run,
+ *  and the complexity curves are fitted to the mean times.
+ *
+ *  @param cfg: the sweep configuration
+ *  @param fn: the benchmark
+ *  @param arg: passed to every run
+ *  @param res: the results
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_sweep_run(ctimer_sweep_t * cfg, ctimer_sweep_fn fn, void * arg, ctimer_sweep_result_t * res)
+{
+    ctimer_interval_t * iv = NULL;
+    int ret = CTIMER_CLOCK_FAILED;
+
+    CHECK(!cfg || !fn || !res, "Invalid sweep arguments!");
+    CHECK(cfg->from < 1 || cfg->to < cfg->from, "Invalid sweep range %lld..%lld",
+          (long long) cfg->from, (long long) cfg->to);
+    CHECK(cfg->mult <= 1 && cfg->step <= 0, "Sweep needs a multiplier above 1 or a positive step!");
+    CHECK(cfg->repeats <= 0, "Invalid number of repeats %lld", (long long) cfg->repeats);
+
+    ret = CTIMER_NOT_ALLOCATED;
+    if(ctimer_create_interval(&iv, "sweep", cfg->clock, CTIMER_NS) != CTIMER_OK) goto error;
+    memset(res, 0, sizeof(ctimer_sweep_result_t));
+
+    for(int64_t n = cfg->from; n > 0; n = sweep_next(cfg, n))
+    {
+        int64_t total = 0, fastest = INT64_MAX;
+        int p = res->points;
+
+        if(p == CTIMER_SWEEP_POINTS)
+        {
+            ERROR("Sweep truncated to %d points", CTIMER_SWEEP_POINTS);
+            break;
+        }
+
+        fn(arg, n);
+        for(int64_t r = 0; r < cfg->repeats; r++)
+        {
+            ctimer_start(iv);
+            if(fn(arg, n) != CTIMER_OK) res->errors++;
+            ctimer_stop(iv);
+
+            int64_t ns = ctimer_elapsed_interval_ns(iv);
+            total += ns;
+            if(ns < fastest) fastest = ns;
+        }
+        res->n[p] = n;
+        res->mean[p] = total / cfg->repeats;
+        res->min[p] = fastest;
+        res->points++;
+    }
+    sweep_fit(res);
+    ret = CTIMER_OK;
+
+error:
+    free(iv);
+    return ret;
+}
+
+/* Function
+ *  interprets the complexity enum as a string
+ *
+ *  @param fit: the complexity curve
+ *
+ *  @return: string The curve, e.g. O(n log n)
+ */
+char * ctimer_print_big_o(ctimer_big_o_e fit)
+{
+    switch(fit)
+    {
+        case CTIMER_O1:
+            return (char *) "O(1)";
+        case CTIMER_OLOGN:
+            return (char *) "O(log n)";
+        case CTIMER_ON:
+            return (char *) "O(n)";
+        case CTIMER_ONLOGN:
+            return (char *) "O(n log n)";
+        case CTIMER_ON2:
+            return (char *) "O(n^2)";
+        case CTIMER_ON3:
+            return (char *) "O(n^3)";
+        default:
+            return (char *) "O(?)";
+    }
+}
+
+/* Function
+ *  print the points of a sweep and the fitted complexity curves
+ *
+ *  @param res: the results
+ *  @param name: printed in front of the results
+ *  @param ut: unit enum of the printed times
+ */
+void ctimer_print_sweep(ctimer_sweep_result_t * res, char * name, ctimer_unit_e ut)
+{
+    char * unit = ctimer_print_unit(ut);
+
+    for(int i = 0; i < res->points; i++)
+        printf("%s n=%lld: mean %.3f %s, min %.3f %s\n", name, (long long) res->n[i],
+               ctimer_ns_to_unit(res->mean[i], ut), unit, ctimer_ns_to_unit(res->min[i], ut), unit);
+    for(int f = 0; f < CTIMER_FITS; f++)
+        printf("%s %s: coef %.4g ns, rms %.1f%%%s\n", name, ctimer_print_big_o((ctimer_big_o_e) f),
+               res->coef[f], 100.0 * res->rms[f], f == (int) res->best ? " (best)" : "");
+    if(res->errors) printf("%s: %lld errors\n", name, (long long) res->errors);
+}
+
+/* Function
+ *  print the points of a sweep as CSV, together with the best fitting
+ *  curve, for plotting
+ *
+ *  @param res: the results
+ *  @param comment: the comment string placed before the header line
+ *  @param ut: unit enum of the printed times
+ */
+void ctimer_print_sweep_csv(ctimer_sweep_result_t * res, char * comment, ctimer_unit_e ut)
+{
+    char * unit = ctimer_print_unit(ut);
+
+    printf("%s n, mean (%s), min (%s), %s (%s)\n", comment, unit, unit,
+           ctimer_print_big_o(res->best), unit);
+    for(int i = 0; i < res->points; i++)
+        printf("%lld, %.3f, %.3f, %.3f\n", (long long) res->n[i],
+               ctimer_ns_to_unit(res->mean[i], ut), ctimer_ns_to_unit(res->min[i], ut),
+               ctimer_ns_to_unit((int64_t) (res->coef[res->best] * big_o_curve(res->best, res->n[i])), ut));
+}
@@ -14,25 +14,42 @@ int main()
     interval_t * a;
     interval_t * b;
     interval_t * c;
+    interval_t * d;
+    interval_t * e;
+    interval_t * f;
 
     create_interval(&a, "Test 1", mono, UNITS);
     create_interval(&b, "Test 2", mono, UNITS);
     create_interval(&c, "Test 3", mono, UNITS);
+    create_interval(&d, "TSC", tsc, UNITS);
+    create_interval(&e, "RAW", monor, UNITS);
+    create_interval(&f, "Cached", cached, UNITS);
+
+    epoch_t epoch;
+    epoch_init(&epoch, mono);
+
+    start(e);
+    start(d);
 
     printf("Running '%s'\n", a->name);
 
+    start(f);
     start(a);
-    nanosleep((struct timespec[]){{1, 0}}, NULL);
+    wait_for(mono, NSEC_PER_SEC);
     stop(a);
+    stop(f);
 
     printf("RAW:\n START: %lld.%.9ld\n END: %lld.%.9ld\n", (long long) a->start.tv_sec, a->start.tv_nsec, (long long) a->stop.tv_sec, a->stop.tv_nsec);
     printf("OUT: %.9f %s\n", elapsed_interval(a, none), print_unit(a->unit));
+    printf("OUT (int): %lld ns, %lld %s\n", (long long) elapsed_interval_ns(a),
+           (long long) elapsed_interval_int(a, none), print_unit(a->unit));
+    printf("OUT (cached): %.9f %s\n", elapsed_interval(f, none), print_unit(f->unit));
     printf("EXPECTED: 1 sec\n");
 
     printf("Running '%s'\n", b->name);
 
     start(b);
-    nanosleep((struct timespec[]){{1, MILLI_TO_NSEC(500)}}, NULL);
+    wait_for(mono, NSEC_PER_SEC + MILLI_TO_NSEC(500));
     stop(b);
 
     printf("RAW:\n START: %lld.%.9ld\n END: %lld.%.9ld\n", (long long) b->start.tv_sec, b->start.tv_nsec, (long long) b->stop.tv_sec, b->stop.tv_nsec);
@@ -42,13 +59,48 @@ int main()
     printf("EXPECTED: 1.5 sec\n");
 
     start(c);
-    nanosleep((struct timespec[]){{2, MILLI_TO_NSEC(756)}}, NULL);
+    wait_for(mono, 2 * NSEC_PER_SEC + MILLI_TO_NSEC(756));
     stop(c);
 
     printf("RAW:\n START: %lld.%.9ld\n END: %lld.%.9ld\n", (long long) c->start.tv_sec, c->start.tv_nsec, (long long) c->stop.tv_sec, c->stop.tv_nsec);
     printf("OUT: %.9f %s\n", elapsed_interval(c, none), print_unit(c->unit));
     printf("EXPECTED: 2.756 sec\n");
 
+    stop(d);
+    stop(e);
+
+    printf("Running 'TSC accuracy'\n");
+    printf("OUT: %lld ns TSC, %lld ns CLOCK_MONOTONIC_RAW, %.3f ppm\n",
+           (long long) elapsed_interval_ns(d), (long long) elapsed_interval_ns(e),
+           (elapsed_interval_ns(d) - elapsed_interval_ns(e)) * 1e6 / elapsed_interval_ns(e));
+    printf("EXPECTED: < 10 ppm\n");
+
+    printf("Running 'Precise wait'\n");
+    print_wait_stats();
+    printf("EXPECTED: overshoot well below 1 us\n");
+
+    printf("Running 'Wall time mapping'\n");
+    char utc[64];
+    struct timespec now, real;
+    epoch_sample(&epoch);
+    format_utc(epoch_to_realtime(&epoch, timespec_to_ns(a->start)), utc, sizeof(utc));
+    printf("OUT: '%s' started at %s\n", a->name, utc);
+    get_time(CLOCK_MONOTONIC, &now);
+    get_time(CLOCK_REALTIME, &real);
+    printf("OUT: mapping error %lld ns\n",
+           (long long) (epoch_to_realtime(&epoch, timespec_to_ns(now)) - timespec_to_ns(real)));
+    int64_t oldest = epoch.pairs[0].clock;
+    for(int i = 0; i < 1000; i++)
+        epoch_sample(&epoch);
+    printf("OUT: %d pairs after 1002 samples, oldest %s\n", epoch.count,
+           epoch.pairs[0].clock == oldest ? "kept" : "dropped");
+    printf("EXPECTED: error within a few micro-seconds; at most %d pairs, oldest kept\n", CTIMER_EPOCH_SAMPLES);
+
+    printf("Running 'TSC health'\n");
+    tsc_report_t report;
+    if(tsc_check(&report, 1000) == OK) print_tsc_report(&report);
+    printf("EXPECTED: healthy on invariant, synchronised TSCs\n");
+
     printf("FINAL TEST\n");
     print_results(3, a, b, c);
     print_results_csv("#", 3, a, b, c);
@@ -56,6 +108,10 @@ int main()
     free(a);
     free(b);
     free(c);
+    free(d);
+    free(e);
+    free(f);
+    cached_clock_stop();
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,74 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "ctimer.h"
+
+/* Built with optimisation, so that the compiler would remove or move the
+ * measured loop if it could */
+
+#define N 1000000
+
+/* Chain of dependent multiply-adds, the compiler sees all of it */
+static inline int64_t work(int64_t x, int64_t n)
+{
+    for(int64_t i = 0; i < n; i++)
+        x = x * 6364136223846793005LL + 1442695040888963407LL;
+    return x;
+}
+
+/* Times the loop with its input and result hidden from the compiler */
+static double guarded(ctimer_interval_t * iv, int64_t n)
+{
+    int64_t seed = 3, result;
+
+    ctimer_start_fenced(iv);
+    CTIMER_DO_NOT_OPTIMIZE(seed);
+    result = work(seed, n);
+    CTIMER_DO_NOT_OPTIMIZE(result);
+    ctimer_stop_fenced(iv);
+    return (double) ctimer_elapsed_interval_ns(iv) / N;
+}
+
+int main()
+{
+    ctimer_interval_t * iv;
+    ctimer_interval_t * it;
+    int64_t sink = 0;
+
+    ctimer_create_interval(&iv, "mono", CTIMER_MONO, CTIMER_NS);
+    ctimer_create_interval(&it, "tsc", CTIMER_TSC, CTIMER_NS);
+
+    printf("Running 'Unguarded loop'\n");
+    ctimer_start(iv);
+    work(3, N);
+    ctimer_stop(iv);
+    printf("Unused result: %.4f ns per iteration\n", (double) ctimer_elapsed_interval_ns(iv) / N);
+    printf("EXPECTED: close to 0, the loop was removed\n");
+
+    printf("Running 'Guarded loop'\n");
+    guarded(iv, N);
+    printf("mono: %.4f ns per iteration\n", guarded(iv, N));
+    printf("tsc: %.4f ns per iteration\n", guarded(it, N));
+    double ratio = guarded(iv, 10 * N) / guarded(iv, N);
+    printf("10x iterations take %.2fx as long\n", ratio);
+    printf("EXPECTED: 1-2 ns per iteration (a multiply-add latency), "
+           "10x iterations ~10x as long\n");
+
+    printf("Running 'Stores inside the region'\n");
+    int64_t * out = &sink;
+    ctimer_start_fenced(iv);
+    for(int64_t i = 0; i < N; i++)
+    {
+        *out += i;
+        CTIMER_CLOBBER_MEMORY();
+    }
+    ctimer_stop_fenced(iv);
+    printf("Stores: %.4f ns per iteration, sum %lld\n",
+           (double) ctimer_elapsed_interval_ns(iv) / N, (long long) sink);
+    printf("EXPECTED: above 0, sum 499999500000\n");
+
+    free(iv);
+    free(it);
+    return EXIT_SUCCESS;
+}
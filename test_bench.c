@@ -0,0 +1,558 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "ctimer.h"
+
+#ifndef UNITS
+#define UNITS CTIMER_US
+#endif
+
+/* Busy call of 100 us, every 100th call stalls for 20 ms */
+static int service(void * arg)
+{
+    int64_t * calls = (int64_t *) arg;
+    struct timespec begin, now;
+    int64_t cost = (++*calls % 100 == 0) ? 20 * CTIMER_NSEC_PER_MSEC : 100 * CTIMER_NSEC_PER_USEC;
+
+    ctimer_get_time(CLOCK_MONOTONIC, &begin);
+    do {
+        ctimer_get_time(CLOCK_MONOTONIC, &now);
+    } while(ctimer_timespec_to_ns(now) - ctimer_timespec_to_ns(begin) < cost);
+    return CTIMER_OK;
+}
+
+/* Busy call of as many nano-seconds as arg points to */
+static int busy(void * arg)
+{
+    int64_t cost = *(int64_t *) arg;
+    int64_t begin = ctimer_get_clock_ns(CTIMER_MONO);
+
+    while(ctimer_get_clock_ns(CTIMER_MONO) - begin < cost);
+    return CTIMER_OK;
+}
+
+/* Follows the chain through the 4096 cache lines arg points to, each load
+ * depends on the previous one */
+static int chase(void * arg)
+{
+    int64_t * lines = (int64_t *) arg;
+    int64_t p = 0;
+
+    for(int i = 0; i < 4096; i++)
+        p = lines[p];
+    return p < 0 ? CTIMER_CALL_FAILED : CTIMER_OK;
+}
+
+static int compare(const void * a, const void * b)
+{
+    int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+    return (x > y) - (x < y);
+}
+
+/* Sorts n pseudo-random values of the buffer arg points to */
+static int sort(void * arg, int64_t n)
+{
+    int64_t * values = (int64_t *) arg;
+    uint64_t x = 88172645463325252ULL;
+
+    for(int64_t i = 0; i < n; i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        values[i] = (int64_t) (x >> 1);
+    }
+    qsort(values, n, sizeof(int64_t), compare);
+    return CTIMER_OK;
+}
+
+/* Fixed amount of computation, independent of other threads */
+static int compute(void * arg, int thread)
+{
+    volatile int64_t x = thread;
+    (void) arg;
+
+    for(int i = 0; i < 4000; i++)
+        x = x * 6364136223846793005LL + 1442695040888963407LL;
+    return CTIMER_OK;
+}
+
+/* Marks one 64 byte operation per milli-second for 2.5 seconds */
+static void * writer(void * arg)
+{
+    ctimer_rate_t * m = (ctimer_rate_t *) arg;
+    int64_t next = ctimer_get_clock_ns(CTIMER_MONO);
+
+    for(int i = 0; i < 2500; i++)
+    {
+        next += CTIMER_NSEC_PER_MSEC;
+        ctimer_wait_until(CTIMER_MONO, next);
+        ctimer_rate_mark(m, 1, 64);
+    }
+    return NULL;
+}
+
+/* Crash reporter of the application, chained to by the flight recorder */
+static void reporter(int sig)
+{
+    (void) sig;
+    _exit(42);
+}
+
+/* Recorders starting together into a windowed histogram */
+typedef struct
+{
+    ctimer_whist_t * whist;
+    pthread_barrier_t * start;
+} recorder_t;
+
+/* Records 10000 values once all recorders are ready */
+static void * recorder(void * arg)
+{
+    recorder_t * r = (recorder_t *) arg;
+
+    pthread_barrier_wait(r->start);
+    for(int i = 0; i < 10000; i++)
+        ctimer_whist_record(r->whist, 1000);
+    return NULL;
+}
+
+/* Records 1000 short intervals of two names into the trace */
+static void * tracer(void * arg)
+{
+    ctimer_trace_t * t = (ctimer_trace_t *) arg;
+    int fast = ctimer_trace_name(t, "fast");
+    int slow = ctimer_trace_name(t, "slow");
+
+    for(int i = 0; i < 1000; i++)
+    {
+        int64_t begin = ctimer_get_clock_ns(CTIMER_MONO);
+        compute(NULL, i);
+        ctimer_trace_record(t, i % 10 ? fast : slow, begin,
+                            ctimer_get_clock_ns(CTIMER_MONO) + (i % 10 ? 0 : 10000));
+    }
+    return NULL;
+}
+
+/* Stage of a request run on its own thread, linked to the request */
+typedef struct
+{
+    ctimer_trace_t * trace;
+    uint32_t parent;
+    int64_t cost;
+} stage_t;
+
+/* Busy for the cost of the stage, recorded as a child of the request */
+static void * worker(void * arg)
+{
+    stage_t * st = (stage_t *) arg;
+    int64_t begin = ctimer_get_clock_ns(CTIMER_MONO);
+
+    busy(&st->cost);
+    ctimer_trace_record_span(st->trace, ctimer_trace_name(st->trace, "work"), 0, st->parent,
+                             begin, ctimer_get_clock_ns(CTIMER_MONO));
+    return NULL;
+}
+
+int main()
+{
+    ctimer_hist_t * h;
+
+    printf("Running 'Histogram'\n");
+    ctimer_create_hist(&h);
+    for(int64_t v = 1; v <= 1000000; v++)
+        ctimer_hist_record(h, v);
+    ctimer_print_hist(h, "1..1000000 ns", UNITS);
+    printf("EXPECTED: p50 500 us, p99 990 us, within 1.6%%\n");
+
+    printf("Running 'Open-loop load'\n");
+    int64_t calls = 0;
+    ctimer_loadgen_t cfg = {1000.0, 2000, CTIMER_MONO};
+    ctimer_loadgen_result_t res = {NULL, NULL, 0, 0, 0, 0};
+    if(ctimer_loadgen_run(&cfg, service, &calls, &res) == CTIMER_OK)
+        ctimer_print_loadgen(&res, UNITS);
+    printf("EXPECTED: 2000 calls in ~2 s, uncorrected p90 ~100 us, "
+           "corrected p90 well above it\n");
+
+    printf("Running 'Rate meter'\n");
+    ctimer_rate_t * m;
+    ctimer_interval_t * iv;
+    pthread_t threads[2];
+    ctimer_create_rate(&m, CTIMER_CACHED);
+    ctimer_create_interval(&iv, "Writers", CTIMER_MONO, UNITS);
+    ctimer_attach_rate(iv, m);
+    ctimer_start(iv);
+    for(int i = 0; i < 2; i++)
+        pthread_create(&threads[i], NULL, writer, m);
+    for(int i = 0; i < 2; i++)
+        pthread_join(threads[i], NULL);
+    ctimer_stop(iv);
+    ctimer_print_rate(m, "Writers");
+    ctimer_print_results(1, iv);
+    ctimer_print_results_csv("#", 1, iv);
+    printf("EXPECTED: 5000 ops, ~2000 ops/s and ~128000 B/s\n");
+
+    printf("Running 'Windowed histogram'\n");
+    ctimer_whist_t * w;
+    ctimer_create_whist(&w, CTIMER_MONO, 200 * CTIMER_NSEC_PER_MSEC, 5);
+    for(int i = 0; i < 1200; i++)
+    {
+        ctimer_whist_record(w, i < 600 ? 1000 : 5000);
+        ctimer_wait_for(CTIMER_MONO, CTIMER_NSEC_PER_MSEC);
+    }
+    ctimer_whist_get(w, 400 * CTIMER_NSEC_PER_MSEC, h);
+    ctimer_print_hist(h, "Last 400 ms", UNITS);
+    ctimer_whist_get(w, CTIMER_NSEC_PER_SEC, h);
+    ctimer_print_hist(h, "Last 1 s", UNITS);
+    printf("EXPECTED: last 400 ms only 5 us, last 1 s also some 1 us\n");
+    ctimer_whist_t * gap;
+    pthread_barrier_t start;
+    pthread_t recorders[4];
+    recorder_t rec;
+    ctimer_create_whist(&gap, CTIMER_MONO, 100 * CTIMER_NSEC_PER_MSEC, 4);
+    pthread_barrier_init(&start, NULL, 4);
+    rec.whist = gap;
+    rec.start = &start;
+    for(int round = 0; round < 2; round++)
+    {
+        /* The second round starts after an idle gap longer than the ring */
+        if(round) ctimer_wait_for(CTIMER_MONO, 600 * CTIMER_NSEC_PER_MSEC);
+        for(int i = 0; i < 4; i++)
+            pthread_create(&recorders[i], NULL, recorder, &rec);
+        for(int i = 0; i < 4; i++)
+            pthread_join(recorders[i], NULL);
+    }
+    ctimer_whist_get(gap, 400 * CTIMER_NSEC_PER_MSEC, h);
+    printf("After an idle gap, 4 threads recorded %lld values\n", (long long) h->count);
+    pthread_barrier_destroy(&start);
+    ctimer_free_whist(gap);
+    printf("EXPECTED: 40000 values\n");
+
+    printf("Running 'A/B comparison'\n");
+    int64_t cost_a = 100 * CTIMER_NSEC_PER_USEC, cost_b = 110 * CTIMER_NSEC_PER_USEC;
+    ctimer_ab_t ab = {500, 20, CTIMER_MONO, 1};
+    ctimer_ab_result_t cmp = {NULL, NULL, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    if(ctimer_ab_run(&ab, busy, &cost_a, busy, &cost_b, &cmp) == CTIMER_OK)
+        ctimer_print_ab(&cmp, "100 us", "110 us", UNITS);
+    printf("EXPECTED: 110 us slower by ~10%%, p well below 0.05\n");
+    char * true_argv[] = {"true", NULL};
+    ab.rounds = 20;
+    ab.warmup = 2;
+    if(ctimer_ab_run_exec(&ab, true_argv, true_argv, &cmp) == CTIMER_OK)
+        ctimer_print_ab(&cmp, "true", "true again", UNITS);
+    printf("EXPECTED: 0 errors, usually no significant difference\n");
+
+    printf("Running 'Cold start'\n");
+    int64_t * lines = (int64_t *) calloc(4096 * 8, sizeof(int64_t));
+    for(int i = 0; i < 4096; i++)
+        lines[i * 8] = (i + 2053) % 4096 * 8;
+    ctimer_region_t region = {lines, 4096 * 8 * sizeof(int64_t)};
+    ctimer_cold_t cold = {50, CTIMER_MONO, CTIMER_COLD_FLUSH | CTIMER_COLD_TLB, 0, &region, 1};
+    ctimer_cold_result_t temp = {NULL, NULL, 0};
+    if(ctimer_cold_run(&cold, chase, lines, &temp) == CTIMER_OK)
+        ctimer_print_cold(&temp, "Flushed 256 KiB", UNITS);
+    cold.iterations = 5;
+    cold.flags = CTIMER_COLD_EVICT;
+    if(ctimer_cold_run(&cold, chase, lines, &temp) == CTIMER_OK)
+        ctimer_print_cold(&temp, "Evicted 256 KiB", UNITS);
+    printf("EXPECTED: cold p50 several times warm p50 in both modes\n");
+
+    printf("Running 'Parameter sweep'\n");
+    int64_t * values = (int64_t *) malloc((1 << 18) * sizeof(int64_t));
+    ctimer_sweep_t sw = {1 << 10, 1 << 18, 2, 0, 5, CTIMER_MONO};
+    ctimer_sweep_result_t sweep;
+    if(ctimer_sweep_run(&sw, sort, values, &sweep) == CTIMER_OK)
+    {
+        ctimer_print_sweep(&sweep, "qsort", UNITS);
+        ctimer_print_sweep_csv(&sweep, "#", UNITS);
+    }
+    printf("EXPECTED: 9 points, best fit O(n log n) with a few %% rms, O(n) close behind\n");
+
+    printf("Running 'Thread scalability'\n");
+    ctimer_scale_t sc = {4, 2000, CTIMER_MONO, CTIMER_PLACE_SPREAD};
+    ctimer_scale_result_t scale;
+    if(ctimer_scale_run(&sc, compute, NULL, &scale) == CTIMER_OK)
+        ctimer_print_scale(&scale, "Compute");
+    printf("EXPECTED: 1, 2 and 4 threads, speedup close to min(threads, %ld CPUs)\n",
+           sysconf(_SC_NPROCESSORS_ONLN));
+
+    printf("Running 'NUMA-local trace'\n");
+    ctimer_trace_t * tr;
+    pthread_t tracers[4];
+    ctimer_create_trace(&tr, CTIMER_MONO, 900, 0);
+    for(int i = 0; i < 4; i++)
+        pthread_create(&tracers[i], NULL, tracer, tr);
+    for(int i = 0; i < 4; i++)
+        pthread_join(tracers[i], NULL);
+    ctimer_print_trace(tr, UNITS);
+    printf("EXPECTED: 3600 samples from 4 threads, 400 dropped, fast and slow per node "
+           "(node 0 only on a single-node machine), slow ~10 us above fast\n");
+
+    printf("Running 'Trace file'\n");
+    ctimer_trace_file_t * tf;
+    if(ctimer_trace_write(tr, "test_trace.ctr") == CTIMER_OK &&
+       ctimer_open_trace_file(&tf, "test_trace.ctr") == CTIMER_OK)
+    {
+        ctimer_tbuf_t * buf = tr->buffers;
+        ctimer_decoder_t dec;
+        ctimer_sample_t s;
+        int64_t i = 0, same = 0;
+
+        for(int64_t b = 0; b < tf->nblocks; b++)
+        {
+            ctimer_decode_block(&dec, tf, b);
+            while(ctimer_decode_next(&dec, &s) > 0)
+            {
+                if(i == buf->count)
+                {
+                    buf = buf->next;
+                    i = 0;
+                }
+                ctimer_sample_t * o = &buf->samples[i++];
+                same += s.start == o->start && s.stop == o->stop && s.name == o->name &&
+                        s.thread == o->thread && s.cpu == o->cpu && s.node == o->node &&
+                        s.id == o->id && s.parent == o->parent;
+            }
+        }
+        printf("File: %lld samples in %lld blocks, %d names, %d wall time pairs, %zu bytes (%.1f per sample), "
+               "%lld decoded equal\n", (long long) tf->samples, (long long) tf->nblocks, tf->nnames,
+               tf->epoch.count, tf->size, (double) tf->size / tf->samples, (long long) same);
+        printf("EXPECTED: 3600 samples in 4 blocks, 2 names, 2 wall time pairs, well below 32 bytes per "
+               "sample, 3600 decoded equal\n");
+
+        printf("Running 'Trace analysis'\n");
+        ctimer_analysis_t * an;
+        if(ctimer_analyze_trace_file(&an, tf, 2, 3) == CTIMER_OK)
+        {
+            ctimer_print_analysis(an, UNITS);
+            ctimer_free_analysis(an);
+        }
+        printf("EXPECTED: 3600 samples of 2 names from 4 threads, fast 810 and slow 90 per thread, "
+               "3 slowest in descending order\n");
+        ctimer_close_trace_file(tf);
+    }
+    remove("test_trace.ctr");
+    ctimer_free_trace(tr);
+
+    printf("Running 'Critical path'\n");
+    ctimer_trace_t * tp;
+    ctimer_sample_t * samples;
+    ctimer_path_t path, again;
+    stage_t stages[3];
+    pthread_t workers[3];
+    int64_t nsamples;
+    ctimer_create_trace(&tp, CTIMER_MONO, 16, 0);
+    uint32_t request = ctimer_trace_id(tp);
+    int64_t begin = ctimer_get_clock_ns(CTIMER_MONO), mark;
+    int64_t parse = 200 * CTIMER_NSEC_PER_USEC, merge = 100 * CTIMER_NSEC_PER_USEC;
+
+    mark = ctimer_get_clock_ns(CTIMER_MONO);
+    busy(&parse);
+    ctimer_trace_record_span(tp, ctimer_trace_name(tp, "parse"), 0, request, mark, ctimer_get_clock_ns(CTIMER_MONO));
+    for(int i = 0; i < 3; i++)
+    {
+        stages[i] = (stage_t) {tp, request, (i == 1 ? 1500 : 300 + 200 * i) * CTIMER_NSEC_PER_USEC};
+        pthread_create(&workers[i], NULL, worker, &stages[i]);
+    }
+    for(int i = 0; i < 3; i++)
+        pthread_join(workers[i], NULL);
+    mark = ctimer_get_clock_ns(CTIMER_MONO);
+    busy(&merge);
+    ctimer_trace_record_span(tp, ctimer_trace_name(tp, "merge"), 0, request, mark, ctimer_get_clock_ns(CTIMER_MONO));
+    ctimer_trace_record_span(tp, ctimer_trace_name(tp, "request"), request, 0, begin, ctimer_get_clock_ns(CTIMER_MONO));
+
+    nsamples = ctimer_trace_collect(tp, &samples);
+    if(nsamples > 0 && ctimer_critical_path(samples, nsamples, request, &path) == CTIMER_OK)
+        ctimer_print_path(&path, samples, tp->names, tp->nnames, UNITS);
+    free(samples);
+
+    /* The links survive the trace file */
+    if(ctimer_trace_write(tp, "test_path.ctr") == CTIMER_OK &&
+       ctimer_open_trace_file(&tf, "test_path.ctr") == CTIMER_OK)
+    {
+        ctimer_decoder_t dec;
+        samples = (ctimer_sample_t *) malloc(tf->samples * sizeof(ctimer_sample_t));
+        nsamples = 0;
+        for(int64_t b = 0; b < tf->nblocks; b++)
+        {
+            ctimer_decode_block(&dec, tf, b);
+            while(ctimer_decode_next(&dec, &samples[nsamples]) > 0)
+                nsamples++;
+        }
+        if(ctimer_critical_path(samples, nsamples, request, &again) == CTIMER_OK)
+            printf("Path from the trace file: %d segments, %s\n", again.nsegs,
+                   again.nsegs == path.nsegs && !memcmp(again.segs, path.segs, path.nsegs * sizeof(ctimer_segment_t))
+                   ? "same" : "different");
+        free(samples);
+        ctimer_close_trace_file(tf);
+    }
+    remove("test_path.ctr");
+    ctimer_free_trace(tp);
+    printf("EXPECTED: parse, work (mostly the thread of the 1500 us stage), merge, "
+           "work ~80%% of the path; same path from the trace file\n");
+
+    printf("Running 'Slow-log'\n");
+    ctimer_slowlog_t * slow;
+    ctimer_interval_t * batch, * req, * query;
+    int64_t quick = CTIMER_NSEC_PER_USEC, stall = 100 * CTIMER_NSEC_PER_USEC;
+    ctimer_create_slowlog(&slow, 50 * CTIMER_NSEC_PER_USEC);
+    ctimer_create_interval(&batch, "batch", CTIMER_MONO, CTIMER_NS);
+    ctimer_create_interval(&req, "request", CTIMER_MONO, CTIMER_NS);
+    ctimer_create_interval(&query, "query", CTIMER_MONO, CTIMER_NS);
+    ctimer_hist_reset(h);
+    ctimer_slow_start(batch);
+    for(int i = 0; i < 200; i++)
+    {
+        ctimer_slow_start(req);
+        ctimer_slow_start(query);
+        busy(i % 50 == 49 ? &stall : &quick);
+        ctimer_slow_stop(slow, query);
+        ctimer_hist_record(h, ctimer_elapsed_interval_ns(query));
+        ctimer_slow_stop(slow, req);
+    }
+    ctimer_slow_stop(slow, batch);
+    ctimer_print_slowlog(slow, UNITS);
+    ctimer_slowlog_adapt(slow, h, 99.0);
+    printf("Adapted threshold: p99 of the queries, %.3f %s\n",
+           ctimer_ns_to_unit(slow->threshold, UNITS), ctimer_print_unit(UNITS));
+    printf("EXPECTED: 9 intervals, 4 times a query (in batch > request) then its request (in batch) "
+           "of ~100 us, then the batch; threshold ~100 us\n");
+
+    ctimer_slowlog_threshold(slow, INT64_MAX);
+    double plain = 0.0, tracked = 0.0;
+    for(int round = 0; round < 2; round++)
+    {
+        int64_t mark = ctimer_get_clock_ns(CTIMER_MONO);
+        for(int i = 0; i < 100000; i++)
+        {
+            ctimer_start(query);
+            ctimer_stop(query);
+        }
+        plain = (ctimer_get_clock_ns(CTIMER_MONO) - mark) / 1e5;
+        mark = ctimer_get_clock_ns(CTIMER_MONO);
+        for(int i = 0; i < 100000; i++)
+        {
+            ctimer_slow_start(query);
+            ctimer_slow_stop(slow, query);
+        }
+        tracked = (ctimer_get_clock_ns(CTIMER_MONO) - mark) / 1e5;
+    }
+    printf("start/stop %.1f ns, slow start/stop below the threshold %.1f ns\n", plain, tracked);
+    printf("EXPECTED: at most a few tens of ns apart\n");
+    free(query);
+    free(req);
+    free(batch);
+    free(slow);
+
+    printf("Running 'Flight recorder'\n");
+    ctimer_trace_t * fr;
+    int64_t cost;
+    ctimer_create_trace(&fr, CTIMER_MONO, 1000, CTIMER_TRACE_RING);
+    int op = ctimer_trace_name(fr, "op");
+    stack_t app_stack = {malloc(SIGSTKSZ), 0, SIGSTKSZ}, cur_stack;
+    sigaltstack(&app_stack, NULL);
+    ctimer_flight_start(fr, "test_flight.ctr", 0);
+    mark = ctimer_get_clock_ns(CTIMER_MONO);
+    for(int i = 0; i < 100000; i++)
+    {
+        int64_t now = ctimer_get_clock_ns(CTIMER_MONO);
+        ctimer_trace_record(fr, op, now - 100, now);
+    }
+    cost = (ctimer_get_clock_ns(CTIMER_MONO) - mark) / 100000;
+    errno = EDOM;
+    raise(SIGUSR2);
+    printf("errno %s by the dump\n", errno == EDOM ? "kept" : "changed");
+    if(ctimer_open_trace_file(&tf, "test_flight.ctr") == CTIMER_OK)
+    {
+        printf("SIGUSR2 dump: %lld samples of %lld recorded, %lld ns per clock read and record\n",
+               (long long) tf->samples, (long long) fr->buffers->count, (long long) cost);
+        ctimer_close_trace_file(tf);
+    }
+    ctimer_flight_stop();
+
+    /* Only the last milli-second */
+    ctimer_flight_start(fr, "test_flight.ctr", CTIMER_NSEC_PER_MSEC);
+    printf("Second start %s\n",
+           ctimer_flight_start(fr, "test_other.ctr", 0) == CTIMER_CALL_FAILED ? "refused" : "accepted");
+    ctimer_wait_for(CTIMER_MONO, 5 * CTIMER_NSEC_PER_MSEC);
+    for(int i = 0; i < 10; i++)
+    {
+        int64_t now = ctimer_get_clock_ns(CTIMER_MONO);
+        ctimer_trace_record(fr, op, now - 100, now);
+    }
+    ctimer_flight_dump(NULL);
+    if(ctimer_open_trace_file(&tf, "test_flight.ctr") == CTIMER_OK)
+    {
+        printf("Windowed dump: %lld samples\n", (long long) tf->samples);
+        ctimer_close_trace_file(tf);
+    }
+    ctimer_flight_stop();
+    remove("test_flight.ctr");
+    sigaltstack(NULL, &cur_stack);
+    printf("Alternate stack of the application %s\n", cur_stack.ss_sp == app_stack.ss_sp ? "restored" : "lost");
+    cur_stack.ss_flags = SS_DISABLE;
+    sigaltstack(&cur_stack, NULL);
+    free(app_stack.ss_sp);
+
+    /* A child that records and dies */
+    pid_t child = fork();
+    if(child == 0)
+    {
+        ctimer_flight_start(fr, "test_crash.ctr", 0);
+        for(int i = 0; i < 10; i++)
+            ctimer_trace_record(fr, op, i, i + 1);
+        abort();
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if(ctimer_open_trace_file(&tf, "test_crash.ctr") == CTIMER_OK)
+    {
+        printf("Crash dump: child died of signal %d, %lld samples\n",
+               WIFSIGNALED(status) ? WTERMSIG(status) : 0, (long long) tf->samples);
+        ctimer_close_trace_file(tf);
+    }
+    remove("test_crash.ctr");
+
+    /* A child with its own crash reporter */
+    child = fork();
+    if(child == 0)
+    {
+        signal(SIGABRT, reporter);
+        ctimer_flight_start(fr, "test_crash.ctr", 0);
+        abort();
+    }
+    waitpid(child, &status, 0);
+    if(ctimer_open_trace_file(&tf, "test_crash.ctr") == CTIMER_OK)
+    {
+        printf("Chained crash: child exited with %d, %lld samples\n",
+               WIFEXITED(status) ? WEXITSTATUS(status) : -1, (long long) tf->samples);
+        ctimer_close_trace_file(tf);
+    }
+    remove("test_crash.ctr");
+    ctimer_free_trace(fr);
+    printf("EXPECTED: errno kept; 1023 of 100000 (the oldest slot is being overwritten), tens of ns; "
+           "second start refused; 10 samples; stack restored;\n          signal %d, 1023 samples; exited with 42, "
+           "1023 samples\n", SIGABRT);
+
+    ctimer_free_whist(w);
+    free(values);
+    free(lines);
+    free(temp.cold);
+    free(temp.warm);
+    free(cmp.a);
+    free(cmp.b);
+    free(iv);
+    free(m);
+    free(res.corrected);
+    free(res.uncorrected);
+    free(h);
+
+    return EXIT_SUCCESS;
+}
@@ -4,8 +4,39 @@
 #include <errno.h>
 #include <stdio.h>
 #include <time.h>
+#include <pthread.h>
 
-#include "timer.h"
+#include "timer_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TICKS 1
+#elif defined(__aarch64__)
+#define HAVE_TICKS 1
+#else
+#define HAVE_TICKS 0
+#endif
+
+/** Globals **/
+
+static ctimer_tsc_calib_t tsc_calib;
+static pthread_once_t tsc_once = PTHREAD_ONCE_INIT;
+static int tsc_period = 0;
+static int tsc_status = CTIMER_CLOCK_FAILED;
+/* The vDSO clock_gettime, NULL for the libc backend; it is switched while
+ * other threads read the time, so it is only accessed atomically */
+typedef int (*vdso_gettime_fn)(clockid_t, struct timespec *);
+static vdso_gettime_fn vdso_gettime = NULL;
+
+/* State of the `cached` clock, cached_ns is 0 while no ticker runs. The
+ * ticker is started and stopped under cached_lock, cached_running tells
+ * the ticker to go on and is read without the lock. */
+static int64_t cached_ns = 0;
+static ctimer_clock_e cached_source = CTIMER_MONO;
+static int64_t cached_period = CTIMER_CACHED_PERIOD_NS;
+static int cached_running = 0;
+static pthread_t cached_thread;
+static pthread_mutex_t cached_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /** Functions **/
 
@@ -18,20 +49,23 @@
  *  @return: the human understandable string meaning of the status value
  */
 inline
-char * error_num(int status)
+char * ctimer_error_num(int status)
 {
     char * tmp;
     switch(status)
     {
-        case OK:
+        case CTIMER_OK:
             tmp = (char *) "status is OK";
             break;
-        case NOT_ALLOCATED:
+        case CTIMER_NOT_ALLOCATED:
             tmp = (char *) "variable not allocated!";
             break;
-        case CLOCK_FAILED:
+        case CTIMER_CLOCK_FAILED:
             tmp = (char *) "clock not available!";
             break;
+        case CTIMER_CALL_FAILED:
+            tmp = (char *) "call under test failed!";
+            break;
         default:
             tmp = (char *) "Unknown status number!";
             break;
@@ -48,30 +82,37 @@ char * error_num(int status)
  *  @return: clockid_t system clock
  */
 inline
-clockid_t set_clock(clock_e ck)
+clockid_t ctimer_set_clock(ctimer_clock_e ck)
 {
     clockid_t clock;
     switch(ck)
     {
-        case rtc:
+        case CTIMER_RTC:
             clock = CLOCK_REALTIME_COARSE;
             break;
-        case mono:
+        case CTIMER_MONO:
             clock = CLOCK_MONOTONIC;
             break;
-        case monoc:
+        case CTIMER_MONOC:
             clock = CLOCK_MONOTONIC_COARSE;
             break;
-        case monor:
+        case CTIMER_MONOR:
+            clock = CLOCK_MONOTONIC_RAW;
+            break;
+        case CTIMER_TSC:
+            /* The tick counter is calibrated against this clock */
             clock = CLOCK_MONOTONIC_RAW;
             break;
-        case cpup:
+        case CTIMER_CACHED:
+            clock = ctimer_set_clock(__atomic_load_n(&cached_source, __ATOMIC_RELAXED));
+            break;
+        case CTIMER_CPUP:
             clock = CLOCK_PROCESS_CPUTIME_ID;
             break;
-        case cput:
+        case CTIMER_CPUT:
             clock = CLOCK_THREAD_CPUTIME_ID;
             break;
-        case monob:
+        case CTIMER_MONOB:
 #ifdef CLOCK_BOOTTIME
             clock = CLOCK_BOOTTIME;
             break;
@@ -79,7 +120,7 @@ clockid_t set_clock(clock_e ck)
         default:
             ERROR("Invalid CLOCK value, using CLOCK_REALTIME");
             /* Fall-through */
-        case rt:
+        case CTIMER_RT:
             clock = CLOCK_REALTIME;
             break;
     }
@@ -96,7 +137,7 @@ clockid_t set_clock(clock_e ck)
  *  @return: struct timespec The difference between start and end
  */
 inline
-struct timespec diff_timespec(struct timespec end, struct timespec begin)
+struct timespec ctimer_diff_timespec(struct timespec end, struct timespec begin)
 {
     struct timespec result = begin;
     /* Perform the carry for the later subtraction. */
@@ -124,17 +165,17 @@ struct timespec diff_timespec(struct timespec end, struct timespec begin)
  * An inline solution would be more practical... but I can't
  * remember how to do it with a struct...
  */
-int set_timespec(struct timespec ** tims, long sec, long nsec)
+int ctimer_set_timespec(struct timespec ** tims, long sec, long nsec)
 {
     *tims = (struct timespec *) malloc(sizeof(struct timespec));
     CHECK(!*tims, "Failed to allocate timespec!");
 
     (*tims)->tv_sec = sec;
     (*tims)->tv_nsec = nsec;
-    return OK;
+    return CTIMER_OK;
 
 error:
-    return NOT_ALLOCATED;
+    return CTIMER_NOT_ALLOCATED;
 }
 
 /* Function
@@ -146,7 +187,7 @@ error:
  *  @return: string The time unit
  */
 inline
-char * print_unit(unit_e unit)
+char * ctimer_print_unit(ctimer_unit_e unit)
 {
     switch(unit)
     {
@@ -180,18 +221,26 @@ char * print_unit(unit_e unit)
  *
  *  @return: status code
  */
-int create_interval(interval_t ** tmp, char * name, clock_e ck, unit_e ut)
+int ctimer_create_interval(ctimer_interval_t ** tmp, char * name, ctimer_clock_e ck, ctimer_unit_e ut)
 {
-    *tmp = (interval_t *) malloc(sizeof(interval_t));
+    *tmp = (ctimer_interval_t *) malloc(sizeof(ctimer_interval_t));
     CHECK(!*tmp, "Unable to create interval %s!", name);
     (*tmp)->name = name;
     (*tmp)->clock = ck;
     (*tmp)->unit = ut;
-    return OK;
+    (*tmp)->rate = NULL;
+    if(ck == CTIMER_TSC && ctimer_calibrate_tsc(CTIMER_TSC_CALIBRATE_MSEC) != CTIMER_OK)
+    {
+        free(*tmp);
+        *tmp = NULL;
+        return CTIMER_CLOCK_FAILED;
+    }
+    if(ck == CTIMER_CACHED) ctimer_cached_clock_ensure();
+    return CTIMER_OK;
 
 error:
     if(*tmp) free(*tmp);
-    return NOT_ALLOCATED;
+    return CTIMER_NOT_ALLOCATED;
 }
 
 /* Function
@@ -203,15 +252,425 @@ error:
  *  @return: either OK, or error status from clock_gettime
  */
 inline
-int get_time(clockid_t clock, struct timespec * time)
+int ctimer_get_time(clockid_t clock, struct timespec * time)
 {
+    vdso_gettime_fn fn = __atomic_load_n(&vdso_gettime, __ATOMIC_RELAXED);
     int ret;
-    ret = clock_gettime(clock, time);
+    if(fn) ret = fn(clock, time);
+    else ret = clock_gettime(clock, time);
     CHECK(ret, "Failed to get start time!");
-    return OK;
+    return CTIMER_OK;
+
+error:
+    return ret;
+}
+
+/* Function
+ *  select the backend used by get_time(). For the vDSO backend the symbol is
+ *  resolved here, if that fails the libc backend stays in use.
+ *
+ *  @param be: backend enum
+ *
+ *  @return: either OK, or CTIMER_CLOCK_FAILED
+ */
+int ctimer_set_backend(ctimer_backend_e be)
+{
+    vdso_gettime_fn fn;
+    void * sym = NULL;
+    switch(be)
+    {
+        case CTIMER_VDSO:
+#if defined(__aarch64__)
+            sym = ctimer_vdso_sym("__kernel_clock_gettime");
+#else
+            sym = ctimer_vdso_sym("__vdso_clock_gettime");
+#endif
+            CHECK(!sym, "vDSO clock_gettime not available, using libc");
+            /* Fall-through */
+        case CTIMER_LIBC:
+            *(void **) &fn = sym;
+            __atomic_store_n(&vdso_gettime, fn, __ATOMIC_RELAXED);
+            break;
+        default:
+            ERROR("Invalid BACKEND value, using libc");
+            __atomic_store_n(&vdso_gettime, NULL, __ATOMIC_RELAXED);
+            break;
+    }
+    return CTIMER_OK;
+
+error:
+    __atomic_store_n(&vdso_gettime, NULL, __ATOMIC_RELAXED);
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  internal thread that updates the `cached` clock every period
+ */
+static
+void * cached_ticker(void * arg)
+{
+    struct timespec time, next;
+    (void) arg;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(__atomic_load_n(&cached_running, __ATOMIC_RELAXED))
+    {
+        if(ctimer_get_clock_time(cached_source, &time) == CTIMER_OK)
+            __atomic_store_n(&cached_ns, ctimer_timespec_to_ns(time), __ATOMIC_RELAXED);
+
+        /* Absolute deadlines keep the period from drifting */
+        next = ctimer_ns_to_timespec(ctimer_timespec_to_ns(next) + cached_period);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return NULL;
+}
+
+/* Function
+ *  internal function starting the ticker, the caller holds cached_lock and
+ *  no ticker runs
+ */
+static
+int cached_start(ctimer_clock_e source, int64_t period)
+{
+    struct timespec time;
+
+    CHECK(source == CTIMER_TSC && ctimer_calibrate_tsc(CTIMER_TSC_CALIBRATE_MSEC),
+          "Unable to calibrate the tick counter!");
+    __atomic_store_n(&cached_source, source, __ATOMIC_RELAXED);
+    cached_period = period;
+
+    /* Readers see a valid time as soon as this returns */
+    CHECK(ctimer_get_clock_time(source, &time), "Unable to read the source clock!");
+    __atomic_store_n(&cached_ns, ctimer_timespec_to_ns(time), __ATOMIC_RELAXED);
+
+    __atomic_store_n(&cached_running, 1, __ATOMIC_RELAXED);
+    if(pthread_create(&cached_thread, NULL, cached_ticker, NULL))
+    {
+        __atomic_store_n(&cached_running, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&cached_ns, 0, __ATOMIC_RELAXED);
+        ERROR("Unable to start the cached clock thread!");
+        return CTIMER_CLOCK_FAILED;
+    }
+    return CTIMER_OK;
 
 error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  internal function stopping the ticker, the caller holds cached_lock
+ */
+static
+void cached_stop(void)
+{
+    if(!__atomic_load_n(&cached_running, __ATOMIC_RELAXED)) return;
+    __atomic_store_n(&cached_running, 0, __ATOMIC_RELAXED);
+    pthread_join(cached_thread, NULL);
+    __atomic_store_n(&cached_ns, 0, __ATOMIC_RELAXED);
+}
+
+/* Function
+ *  start the background thread of the `cached` clock, replacing a running
+ *  one. The source must advance for every thread alike, so neither the
+ *  `cached` clock itself nor a CPU-time clock can be cached.
+ *
+ *  @param source: the clock being cached
+ *  @param period: the update period in nano-seconds
+ *
+ *  @return: either OK, or CTIMER_CLOCK_FAILED
+ */
+int ctimer_cached_clock_start(ctimer_clock_e source, int64_t period)
+{
+    int ret;
+
+    CHECK(source == CTIMER_CACHED, "The cached clock can not cache itself!");
+    CHECK(source == CTIMER_CPUP || source == CTIMER_CPUT, "CPU-time clocks can not be cached!");
+    CHECK(period <= 0, "Invalid update period %lld ns", (long long) period);
+
+    pthread_mutex_lock(&cached_lock);
+    cached_stop();
+    ret = cached_start(source, period);
+    pthread_mutex_unlock(&cached_lock);
     return ret;
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  internal function starting the `cached` clock with the defaults unless
+ *  a ticker runs already, for the first `cached` user
+ *
+ *  @return: either OK, or CTIMER_CLOCK_FAILED
+ */
+int ctimer_cached_clock_ensure(void)
+{
+    int ret = CTIMER_OK;
+
+    if(__atomic_load_n(&cached_running, __ATOMIC_RELAXED)) return CTIMER_OK;
+    pthread_mutex_lock(&cached_lock);
+    if(!__atomic_load_n(&cached_running, __ATOMIC_RELAXED))
+        ret = cached_start(CTIMER_MONO, CTIMER_CACHED_PERIOD_NS);
+    pthread_mutex_unlock(&cached_lock);
+    return ret;
+}
+
+/* Function
+ *  stop the background thread of the `cached` clock, afterwards `cached`
+ *  intervals read the source clock directly.
+ *
+ *  @return: status code
+ */
+int ctimer_cached_clock_stop(void)
+{
+    pthread_mutex_lock(&cached_lock);
+    cached_stop();
+    pthread_mutex_unlock(&cached_lock);
+    return CTIMER_OK;
+}
+
+/* Function
+ *  read the `cached` clock
+ *
+ *  @return: the last stored time in nano-seconds, or 0 if no ticker runs
+ */
+inline
+int64_t ctimer_cached_now_ns(void)
+{
+    return __atomic_load_n(&cached_ns, __ATOMIC_RELAXED);
+}
+
+/* Function
+ *  read the raw CPU tick counter
+ *
+ *  @return: the current tick count, or CLOCK_MONOTONIC_RAW nanoseconds on
+ *           architectures without a usable tick counter
+ */
+inline
+uint64_t ctimer_read_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r" (ticks) :: "memory");
+    return ticks;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+    return (uint64_t) ctimer_timespec_to_ns(time);
+#endif
+}
+
+/* Function
+ *  internal function that computes (ticks * mult) >> shift without
+ *  overflowing, mult must fit into 32 bits.
+ */
+static inline
+uint64_t mul_shift(uint64_t ticks, uint64_t mult, uint32_t shift)
+{
+#ifdef __SIZEOF_INT128__
+    return (uint64_t) (((unsigned __int128) ticks * mult) >> shift);
+#else
+    /* The 96-bit product as high:low 64-bit halves, from two 64-bit
+     * partial products that can not overflow */
+    uint64_t a = (ticks >> 32) * mult;
+    uint64_t b = (ticks & 0xffffffffULL) * mult;
+    uint64_t low = (a << 32) + b;
+    uint64_t high = (a >> 32) + (low < b);
+    if(shift == 0) return low;
+    return (high << (64 - shift)) | (low >> shift);
+#endif
+}
+
+/* Function
+ *  take a paired (ticks, CLOCK_MONOTONIC_RAW) reading, using the midpoint
+ *  of two tick reads around clock_gettime. The tightest of a few attempts
+ *  is kept to filter out preemption.
+ */
+void ctimer_paired_reading(uint64_t * ticks, int64_t * nsec)
+{
+    struct timespec time;
+    uint64_t before, after;
+    uint64_t best = UINT64_MAX;
+
+    for(int i = 0; i < 8; i++)
+    {
+        before = ctimer_read_ticks();
+        clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+        after = ctimer_read_ticks();
+
+        if(after - before < best)
+        {
+            best = after - before;
+            *ticks = before + (after - before) / 2;
+            *nsec = ctimer_timespec_to_ns(time);
+        }
+    }
+}
+
+/* Function
+ *  internal function calibrating the tick counter, the conversion is
+ *  published by the release stores of `healthy` and `calibrated`
+ */
+static
+int tsc_calibrate(int msec)
+{
+    uint64_t ticks0, ticks1, freq;
+    int64_t nsec0, nsec1;
+    uint32_t shift;
+    uint64_t mult = 0;
+
+#if !HAVE_TICKS
+    DEBUG("No tick counter available, using CLOCK_MONOTONIC_RAW");
+    (void) msec;
+    freq = CTIMER_NSEC_PER_SEC;
+    ctimer_paired_reading(&ticks0, &nsec0);
+#elif defined(__aarch64__)
+    /* The generic timer reports its own frequency */
+    (void) msec;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r" (freq));
+    ctimer_paired_reading(&ticks0, &nsec0);
+#else
+    ctimer_paired_reading(&ticks0, &nsec0);
+    do {
+        ctimer_paired_reading(&ticks1, &nsec1);
+    } while(nsec1 - nsec0 < msec * CTIMER_NSEC_PER_MSEC);
+    freq = (ticks1 - ticks0) * CTIMER_NSEC_PER_SEC / (uint64_t) (nsec1 - nsec0);
+#endif
+    CHECK(freq == 0, "Tick counter does not advance!");
+
+    /* Like the kernel's clocks_calc_mult_shift(), pick the largest shift
+     * for which mult still fits into 32 bits. */
+    for(shift = 32; shift > 0; shift--)
+    {
+        mult = ((uint64_t) CTIMER_NSEC_PER_SEC << shift) / freq;
+        if(mult <= 0xffffffffULL) break;
+    }
+
+    tsc_calib.mult = mult;
+    tsc_calib.shift = shift;
+    tsc_calib.freq = freq;
+    tsc_calib.ref_ticks = ticks0;
+    tsc_calib.ref_ns = nsec0;
+    __atomic_store_n(&tsc_calib.healthy, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&tsc_calib.calibrated, 1, __ATOMIC_RELEASE);
+    DEBUG("Tick counter at %llu Hz, mult %llu, shift %u",
+          (unsigned long long) freq, (unsigned long long) mult, shift);
+    return CTIMER_OK;
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  internal function run once per process by ctimer_calibrate_tsc()
+ */
+static
+void tsc_calibrate_once(void)
+{
+    tsc_status = tsc_calibrate(__atomic_load_n(&tsc_period, __ATOMIC_RELAXED));
+}
+
+/* Function
+ *  calibrate the tick counter against CLOCK_MONOTONIC_RAW and compute the
+ *  multiply-shift pair used to convert ticks into nanoseconds. This is done
+ *  once per process: the first call blocks for the calibration period,
+ *  later calls, also from other threads, wait for it and return its status.
+ *  Creating the first `tsc` interval calibrates too, so call this at
+ *  start-up to keep the calibration out of timed code.
+ *
+ *  @param msec: the calibration period in milli-seconds
+ *
+ *  @return: either OK, or CTIMER_CLOCK_FAILED
+ */
+int ctimer_calibrate_tsc(int msec)
+{
+    int unset = 0;
+
+    CHECK(msec <= 0 || msec > 1000, "Invalid calibration period %d ms", msec);
+    __atomic_compare_exchange_n(&tsc_period, &unset, msec, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    pthread_once(&tsc_once, tsc_calibrate_once);
+    return tsc_status;
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  access the current tick counter calibration
+ *
+ *  @return: pointer to the calibration data
+ */
+ctimer_tsc_calib_t * ctimer_get_tsc_calib(void)
+{
+    return &tsc_calib;
+}
+
+/* Function
+ *  convert a tick count to CLOCK_MONOTONIC_RAW based nanoseconds using the
+ *  calibrated multiply-shift pair.
+ *
+ *  @param ticks: value returned by ctimer_read_ticks()
+ *
+ *  @return: the time in nanoseconds
+ */
+inline
+int64_t ctimer_ticks_to_ns(uint64_t ticks)
+{
+    /* Readings from another core may lie slightly before the reference */
+    if(ticks >= tsc_calib.ref_ticks)
+        return tsc_calib.ref_ns + (int64_t) mul_shift(ticks - tsc_calib.ref_ticks,
+                                                      tsc_calib.mult, tsc_calib.shift);
+    return tsc_calib.ref_ns - (int64_t) mul_shift(tsc_calib.ref_ticks - ticks,
+                                                  tsc_calib.mult, tsc_calib.shift);
+}
+
+/* Function
+ *  get the current time of the given clock enum, this is get_time() with
+ *  support for clocks that are not backed by clock_gettime.
+ *
+ *  @param ck: clock enum
+ *  @param time: the timespec structure that holds the time
+ *
+ *  @return: either OK, or error status from clock_gettime
+ */
+inline
+int ctimer_get_clock_time(ctimer_clock_e ck, struct timespec * time)
+{
+    /* An uncalibrated or unhealthy tick counter falls back to
+     * CLOCK_MONOTONIC_RAW, see ctimer_set_clock() */
+    if(ck == CTIMER_TSC && __atomic_load_n(&tsc_calib.healthy, __ATOMIC_ACQUIRE))
+    {
+        *time = ctimer_ns_to_timespec(ctimer_ticks_to_ns(ctimer_read_ticks()));
+        return CTIMER_OK;
+    }
+    if(ck == CTIMER_CACHED)
+    {
+        int64_t nsec = ctimer_cached_now_ns();
+        if(nsec)
+        {
+            *time = ctimer_ns_to_timespec(nsec);
+            return CTIMER_OK;
+        }
+        ck = __atomic_load_n(&cached_source, __ATOMIC_RELAXED);
+    }
+    return ctimer_get_time(ctimer_set_clock(ck), time);
+}
+
+/* Function
+ *  get the current time of the given clock enum in nano-seconds
+ *
+ *  @param ck: clock enum
+ *
+ *  @return: the time in nano-seconds, or 0 if the clock failed
+ */
+inline
+int64_t ctimer_get_clock_ns(ctimer_clock_e ck)
+{
+    struct timespec time;
+    if(ctimer_get_clock_time(ck, &time) != CTIMER_OK) return 0;
+    return ctimer_timespec_to_ns(time);
 }
 
 /* Function
@@ -221,9 +680,9 @@ error:
  *
  *  @return: either OK, or error status from clock_gettime
  */
-int start(interval_t * tmp)
+int ctimer_start(ctimer_interval_t * tmp)
 {
-    return get_time(set_clock(tmp->clock), &(tmp->start));
+    return ctimer_get_clock_time(tmp->clock, &(tmp->start));
 }
 
 /* Function
@@ -233,118 +692,343 @@ int start(interval_t * tmp)
  *
  *  @return: either OK, or error status from clock_gettime
  */
-int stop(interval_t * tmp)
+int ctimer_stop(ctimer_interval_t * tmp)
 {
-    return get_time(set_clock(tmp->clock), &(tmp->stop));
+    return ctimer_get_clock_time(tmp->clock, &(tmp->stop));
 }
 
 /* Function
- *  compute the elapsed time from the interval
+ *  internal function reading the tick counter at the start of a timed
+ *  region: all earlier instructions complete before the read and no later
+ *  instruction starts before it.
+ */
+static inline
+uint64_t start_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t ticks;
+    _mm_lfence();
+    ticks = __rdtsc();
+    _mm_lfence();
+    return ticks;
+#elif defined(__aarch64__)
+    uint64_t ticks = ctimer_read_ticks();
+    __asm__ __volatile__("isb" ::: "memory");
+    return ticks;
+#else
+    return ctimer_read_ticks();
+#endif
+}
+
+/* Function
+ *  internal function reading the tick counter at the end of a timed region:
+ *  rdtscp waits for all earlier instructions and the lfence keeps later
+ *  ones from starting before the read.
+ */
+static inline
+uint64_t stop_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int aux;
+    uint64_t ticks = __rdtscp(&aux);
+    _mm_lfence();
+    return ticks;
+#elif defined(__aarch64__)
+    uint64_t ticks = ctimer_read_ticks();
+    __asm__ __volatile__("isb" ::: "memory");
+    return ticks;
+#else
+    return ctimer_read_ticks();
+#endif
+}
+
+/* Function
+ *  like ctimer_start(), but keeps the timed code from being moved before
+ *  the reading: the compiler may not move memory accesses across it and
+ *  with the `tsc` clock the CPU may not execute later instructions ahead
+ *  of the tick counter read. Values only held in registers need
+ *  CTIMER_DO_NOT_OPTIMIZE() as well.
+ *
+ *  @param tmp: the interval
+ *
+ *  @return: either OK, or error status from clock_gettime
+ */
+int ctimer_start_fenced(ctimer_interval_t * tmp)
+{
+    int ret = CTIMER_OK;
+
+    CTIMER_CLOBBER_MEMORY();
+#if HAVE_TICKS
+    if(tmp->clock == CTIMER_TSC && __atomic_load_n(&tsc_calib.healthy, __ATOMIC_ACQUIRE))
+        tmp->start = ctimer_ns_to_timespec(ctimer_ticks_to_ns(start_ticks()));
+    else
+#endif
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        ret = ctimer_get_clock_time(tmp->clock, &(tmp->start));
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+    CTIMER_CLOBBER_MEMORY();
+    return ret;
+}
+
+/* Function
+ *  like ctimer_stop(), but keeps the timed code from being moved after the
+ *  reading, see ctimer_start_fenced()
  *
  *  @param tmp: the interval
+ *
+ *  @return: either OK, or error status from clock_gettime
+ */
+int ctimer_stop_fenced(ctimer_interval_t * tmp)
+{
+    int ret = CTIMER_OK;
+
+    CTIMER_CLOBBER_MEMORY();
+#if HAVE_TICKS
+    if(tmp->clock == CTIMER_TSC && __atomic_load_n(&tsc_calib.healthy, __ATOMIC_ACQUIRE))
+        tmp->stop = ctimer_ns_to_timespec(ctimer_ticks_to_ns(stop_ticks()));
+    else
+#endif
+    {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        ret = ctimer_get_clock_time(tmp->clock, &(tmp->stop));
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+    CTIMER_CLOBBER_MEMORY();
+    return ret;
+}
+
+/* Function
+ *  convert a struct timespec into an integer count of nanoseconds
+ *
+ *  @param time: the timespec
+ *
+ *  @return: the time in nanoseconds
+ */
+inline
+int64_t ctimer_timespec_to_ns(struct timespec time)
+{
+    return (int64_t) time.tv_sec * CTIMER_NSEC_PER_SEC + time.tv_nsec;
+}
+
+/* Function
+ *  convert an integer count of nanoseconds into a struct timespec
+ *
+ *  @param nsec: the time in nanoseconds
+ *
+ *  @return: the timespec, with tv_nsec normalised to [0, CTIMER_NSEC_PER_SEC)
+ */
+inline
+struct timespec ctimer_ns_to_timespec(int64_t nsec)
+{
+    struct timespec time;
+    time.tv_sec = nsec / CTIMER_NSEC_PER_SEC;
+    time.tv_nsec = nsec % CTIMER_NSEC_PER_SEC;
+    if (time.tv_nsec < 0) {
+        time.tv_nsec += CTIMER_NSEC_PER_SEC;
+        time.tv_sec -= 1;
+    }
+    return time;
+}
+
+/* Function
+ *  convert nanoseconds into the given unit using integer arithmetic only;
+ *  the result is truncated towards zero.
+ *
+ *  @param nsec: the time in nanoseconds
  *  @param ut: unit enum
  *
- *  @return: the elapsed time in the global time unit
+ *  @return: the time in the given unit
  */
 inline
-double elapsed_interval(interval_t * tmp, unit_e ut)
+int64_t ctimer_ns_to_unit_int(int64_t nsec, ctimer_unit_e ut)
 {
-    double time = 0.0;
-    unit_e unit;
-    struct timespec diff;
+    switch(ut)
+    {
+        default:
+            ERROR("Invalid UNIT value, using seconds (s)");
+            /* Fall-through */
+        case CTIMER_S:
+            return nsec / CTIMER_NSEC_PER_SEC;
+        case CTIMER_MS:
+            return nsec / CTIMER_NSEC_PER_MSEC;
+        case CTIMER_US:
+            return nsec / CTIMER_NSEC_PER_USEC;
+        case CTIMER_NS:
+            return nsec;
+    }
+}
 
-    diff = diff_timespec(tmp->stop, tmp->start);
-    unit = 0 <= ut && ut < unit_check ? ut : tmp->unit;
-    switch(unit)
+/* Function
+ *  convert nanoseconds into the given unit as a double; intended for
+ *  reporting, after all arithmetic has been done on integers.
+ *
+ *  @param nsec: the time in nanoseconds
+ *  @param ut: unit enum
+ *
+ *  @return: the time in the given unit
+ */
+inline
+double ctimer_ns_to_unit(int64_t nsec, ctimer_unit_e ut)
+{
+    /* Split off the whole part so that large values keep their
+     * sub-unit precision. */
+    switch(ut)
     {
         default:
             ERROR("Invalid UNIT value, using seconds (s)");
             /* Fall-through */
-        case s:
-            time = (double) diff.tv_sec + NANO_TO_SEC(diff.tv_nsec);
-            break;
-        case ms:
-            time = (double) SEC_TO_MSEC(diff.tv_sec) + NANO_TO_MSEC(diff.tv_nsec);
-            break;
-        case us:
-            time = (double) SEC_TO_MCSEC(diff.tv_sec) + NANO_TO_MCSEC(diff.tv_nsec);
-            break;
-        case ns:
-            time = (double) SEC_TO_NSEC(diff.tv_sec) + diff.tv_nsec;
-            break;
+        case CTIMER_S:
+            return (double) (nsec / CTIMER_NSEC_PER_SEC)
+                + CTIMER_NANO_TO_SEC((double) (nsec % CTIMER_NSEC_PER_SEC));
+        case CTIMER_MS:
+            return (double) (nsec / CTIMER_NSEC_PER_MSEC)
+                + CTIMER_NANO_TO_MSEC((double) (nsec % CTIMER_NSEC_PER_MSEC));
+        case CTIMER_US:
+            return (double) (nsec / CTIMER_NSEC_PER_USEC)
+                + CTIMER_NANO_TO_MCSEC((double) (nsec % CTIMER_NSEC_PER_USEC));
+        case CTIMER_NS:
+            return (double) nsec;
     }
-    return time;
+}
+
+/* Function
+ *  compute the elapsed time from the interval in nanoseconds
+ *
+ *  @param tmp: the interval
+ *
+ *  @return: the elapsed time in nanoseconds
+ */
+inline
+int64_t ctimer_elapsed_interval_ns(ctimer_interval_t * tmp)
+{
+    return ctimer_timespec_to_ns(tmp->stop) - ctimer_timespec_to_ns(tmp->start);
+}
+
+/* Function
+ *  compute the elapsed time from the interval as an integer
+ *
+ *  @param tmp: the interval
+ *  @param ut: unit enum
+ *
+ *  @return: the elapsed time in the given unit, truncated
+ */
+inline
+int64_t ctimer_elapsed_interval_int(ctimer_interval_t * tmp, ctimer_unit_e ut)
+{
+    ctimer_unit_e unit = 0 <= ut && ut < CTIMER_UNIT_CHECK ? ut : tmp->unit;
+    return ctimer_ns_to_unit_int(ctimer_elapsed_interval_ns(tmp), unit);
+}
+
+/* Function
+ *  compute the elapsed time from the interval
+ *
+ *  @param tmp: the interval
+ *  @param ut: unit enum
+ *
+ *  @return: the elapsed time in the global time unit
+ */
+inline
+double ctimer_elapsed_interval(ctimer_interval_t * tmp, ctimer_unit_e ut)
+{
+    ctimer_unit_e unit = 0 <= ut && ut < CTIMER_UNIT_CHECK ? ut : tmp->unit;
+    return ctimer_ns_to_unit(ctimer_elapsed_interval_ns(tmp), unit);
 }
 
 /* Function
  *  this function prints out the elapsed time(s) from the given interval(s). It supports
- *  several different print formats.
+ *  several different print formats. Intervals with a rate meter attached also
+ *  print its totals per second of elapsed time.
  *
  *  @param num: the number of intervals to be printed
  *  @param ...: the interval(s)
  */
 inline
-void print_results(int num, ...)
+void ctimer_print_results(int num, ...)
 {
     va_list vl;
     char * names[num];
-    double values[num];
-    unit_e units[num];
+    int64_t values[num];
+    ctimer_unit_e units[num];
+    int64_t events[num];
+    int64_t bytes[num];
+    int rated[num];
 
     va_start(vl, num);
     for(int i = 0; i < num; i++)
     {
-        interval_t * time = va_arg(vl, interval_t *);
+        ctimer_interval_t * time = va_arg(vl, ctimer_interval_t *);
         units[i] = time->unit;
         names[i] = (time->name == NULL) ? NULL : strdup(time->name);
-        values[i] = elapsed_interval(time, none);
+        values[i] = ctimer_elapsed_interval_ns(time);
+        rated[i] = time->rate != NULL;
+        events[i] = rated[i] ? __atomic_load_n(&time->rate->events, __ATOMIC_RELAXED) : 0;
+        bytes[i] = rated[i] ? __atomic_load_n(&time->rate->bytes, __ATOMIC_RELAXED) : 0;
     }
     va_end(vl);
 
     for(int i = 0; i < num; i++)
     {
-        printf("%s: %.3f %s\n", names[i], values[i], print_unit(units[i]));
+        printf("%s: %.3f %s", names[i], ctimer_ns_to_unit(values[i], units[i]),
+               ctimer_print_unit(units[i]));
+        if(rated[i] && values[i] > 0)
+            printf(" (%.1f ops/s, %.1f B/s)", events[i] / ctimer_ns_to_unit(values[i], CTIMER_S),
+                   bytes[i] / ctimer_ns_to_unit(values[i], CTIMER_S));
+        printf("\n");
         free(names[i]);
     }
 }
 
 /* Function
  *  this function prints out the elapsed time(s) from the given interval(s).
- *  Print out is in a CSV compatible format.
+ *  Print out is in a CSV compatible format. Intervals with a rate meter
+ *  attached get two extra columns with operations and bytes per second.
  *
  *  @param comment: comment character that precedes the headers
  *  @param num: the number of intervals to be printed
  *  @param ...: the interval(s)
  */
 inline
-void print_results_csv(char * comment, int num, ...)
+void ctimer_print_results_csv(char * comment, int num, ...)
 {
     va_list vl;
     char * names[num];
-    double values[num];
-    unit_e units[num];
+    int64_t values[num];
+    ctimer_unit_e units[num];
+    int64_t events[num];
+    int64_t bytes[num];
+    int rated[num];
 
     va_start(vl, num);
     for(int i = 0; i < num; i++)
     {
-        interval_t * time = va_arg(vl, interval_t *);
+        ctimer_interval_t * time = va_arg(vl, ctimer_interval_t *);
         units[i] = time->unit;
         names[i] = (time->name == NULL) ? NULL : strdup(time->name);
-        values[i] = elapsed_interval(time, none);
+        values[i] = ctimer_elapsed_interval_ns(time);
+        rated[i] = time->rate != NULL;
+        events[i] = rated[i] ? __atomic_load_n(&time->rate->events, __ATOMIC_RELAXED) : 0;
+        bytes[i] = rated[i] ? __atomic_load_n(&time->rate->bytes, __ATOMIC_RELAXED) : 0;
     }
     va_end(vl);
 
     printf("%s ", comment);
     for(int i = 0; i < num; i++)
     {
-        printf("%s (%s)", names[i], print_unit(units[i]));
+        printf("%s (%s)", names[i], ctimer_print_unit(units[i]));
+        if(rated[i]) printf(", %s (ops/s), %s (B/s)", names[i], names[i]);
         free(names[i]);
         if(i < num - 1) printf(", ");
     }
     printf("\n");
     for(int i = 0; i < num; i++)
     {
-        printf("%.3f", values[i]);
+        printf("%.3f", ctimer_ns_to_unit(values[i], units[i]));
+        if(rated[i])
+            printf(", %.1f, %.1f",
+                   values[i] > 0 ? events[i] / ctimer_ns_to_unit(values[i], CTIMER_S) : 0.0,
+                   values[i] > 0 ? bytes[i] / ctimer_ns_to_unit(values[i], CTIMER_S) : 0.0);
         if(i < num - 1) printf(", ");
     }
     printf("\n");
@@ -1,16 +1,11 @@
 /* ***************************************************************************
- * This header file provides a rudimentary timing facility for C/C++ based
- * applications
+ * Compatibility header providing the unprefixed names of earlier versions,
+ * e.g. `start`, `interval_t`, `mono` or `OK`, on top of "ctimer.h".
  *
- * Makes use of the POSIX standard derived timing mechanisms found within the
- * C/C++ standard library. Specifically we use the `clock_gettime` function.
- *
- * This header file was designed for use for the accurate profiling of
- * applications in the context of benchmarking. It was created as part of a
- * masters project to investigate the performance portability between OpenCL
- * and Single-Assignment C (http://www.sac-home.org/) programming models.
- *
- * Created by Hans-Nikolai Viessmann (C) 2015 - 2016
+ * These short names easily collide with application code, new code should
+ * include "ctimer.h" and use the `ctimer_` / `CTIMER_` names instead. The
+ * compile time configuration macros (e.g. HIST_PRECISION) only exist with
+ * the CTIMER_ prefix.
  *
  * Following macros are available to manipulate verbose output:
  *  -   TIMERVER -> 0 (off) 1 (print errors: default) 2 (debug)
@@ -19,18 +14,14 @@
 #ifndef __TIMER_HEADER_GUARD__
 #define __TIMER_HEADER_GUARD__
 
-#if __cplusplus
-extern "C" {
+#if defined(__CTIMER_HEADER_GUARD__) && !defined(CTIMER_COMPAT)
+#error "timer.h must be included before ctimer.h"
 #endif
 
-#ifndef TIMERVER
-/* Verbosity level, the following values are considered valid:
- * - 0 : verbosity off
- * - 1 : error messages
- * - 2 : debug
- */
-#define TIMERVER 1
-#endif
+#include <stdio.h>
+
+#define CTIMER_COMPAT
+#include "ctimer.h"
 
 /** Macros for verbosity **/
 
@@ -57,128 +48,116 @@ extern "C" {
 
 /** Error related **/
 
-#define OK 0
-#define NOT_ALLOCATED -1
-#define CLOCK_FAILED -2
+#define OK CTIMER_OK
+#define NOT_ALLOCATED CTIMER_NOT_ALLOCATED
+#define CLOCK_FAILED CTIMER_CLOCK_FAILED
 
 /** Time conversions **/
 
-#define NANO_TO_SEC(time) (time / 1000000000.0)
-#define NANO_TO_MSEC(time) (time / 1000000.0)
-#define NANO_TO_MCSEC(time) (time / 1000.0)
+#define NANO_TO_SEC(time) CTIMER_NANO_TO_SEC(time)
+#define NANO_TO_MSEC(time) CTIMER_NANO_TO_MSEC(time)
+#define NANO_TO_MCSEC(time) CTIMER_NANO_TO_MCSEC(time)
 
-#define MICRO_TO_SEC(time) (time / 1000000.0)
-#define MICRO_TO_MSEC(time) (time / 1000.0)
-#define MICRO_TO_NSEC(time) (time * 1000.0)
+#define MICRO_TO_SEC(time) CTIMER_MICRO_TO_SEC(time)
+#define MICRO_TO_MSEC(time) CTIMER_MICRO_TO_MSEC(time)
+#define MICRO_TO_NSEC(time) CTIMER_MICRO_TO_NSEC(time)
 
-#define MILLI_TO_SEC(time) (time / 1000.0)
-#define MILLI_TO_MCSEC(time) (time * 1000.0)
-#define MILLI_TO_NSEC(time) (time * 1000000.0)
+#define MILLI_TO_SEC(time) CTIMER_MILLI_TO_SEC(time)
+#define MILLI_TO_MCSEC(time) CTIMER_MILLI_TO_MCSEC(time)
+#define MILLI_TO_NSEC(time) CTIMER_MILLI_TO_NSEC(time)
 
-#define SEC_TO_MSEC(time) (time * 1000.0)
-#define SEC_TO_MCSEC(time) (time * 1000000.0)
-#define SEC_TO_NSEC(time) (time * 1000000000.0)
+#define SEC_TO_MSEC(time) CTIMER_SEC_TO_MSEC(time)
+#define SEC_TO_MCSEC(time) CTIMER_SEC_TO_MCSEC(time)
+#define SEC_TO_NSEC(time) CTIMER_SEC_TO_NSEC(time)
+
+/** Integer time conversions **/
+
+#define NSEC_PER_USEC CTIMER_NSEC_PER_USEC
+#define NSEC_PER_MSEC CTIMER_NSEC_PER_MSEC
+#define NSEC_PER_SEC CTIMER_NSEC_PER_SEC
 
 /** Global types **/
 
-/* Enum of time units */
-typedef enum
-{
-    s,   // seconds
-    ms,  // milli-seconds
-    us,  // micro-seconds
-    ns,  // nano-seconds
-    unit_check, // used for enum check
-    none // use the intervals unit
-} unit_e;
-
-/* Enum of system clocks */
-typedef enum
-{
-    rt,
- /* - CLOCK_REALTIME
-  *       System-wide clock that measures real (i.e., wall-clock) time. Setting
-  *       this clock requires appropriate privileges. This clock is affected by
-  *       discontinuous jumps in the system time (e.g., if the system
-  *       administrator manually changes the clock), and by the incremental
-  *       adjustments performed by adjtime(3) and NTP.
-  */
-    rtc,
- /* - CLOCK_REALTIME_COARSE   (Linux only!)
-  *       A faster but less precise version of CLOCK_REALTIME. Use when you
-  *       need very fast, but not fine-grained timestamps.
-  */
-    mono,
- /* - CLOCK_MONOTONIC         (Linux only!)
-  *       Clock that cannot be set and represents monotonic time since some
-  *       unspecified starting point. This clock is not affected by
-  *       discontinuous jumps in the system time (e.g., if the system
-  *       administrator manually changes the clock), but is affected by the
-  *       incremental adjustments performed by adjtime(3) and NTP.
-  */
-    monoc,
- /* - CLOCK_MONOTONIC_COARSE  (Linux only!)
-  *       A faster but less precise version of CLOCK_MONOTONIC. Use when you
-  *       need very fast, but not fine-grained timestamps.
-  */
-    monor,
- /* - CLOCK_MONOTONIC_RAW     (Linux only!)
-  *       Similar to CLOCK_MONOTONIC, but provides access to a raw
-  *       hardware-based time that is not subject to NTP adjustments or the
-  *       incremental adjustments performed by adjtime(3).
-  */
-    monob,
- /* - CLOCK_BOOTTIME          (Linux only!)
-  *       Identical to CLOCK_MONOTONIC, except it also includes any time that
-  *       the system is suspended. This allows applications to get a
-  *       suspend-aware monotonic clock without having to deal with the
-  *       complications of CLOCK_REALTIME, which may have discontinuities if
-  *       the time is changed using settimeofday(2).
-  */
-    cpup,
- /* - CLOCK_PROCESS_CPUTIME_ID
-  *       High-resolution per-process timer from the CPU.
-  */
-    cput
- /* - CLOCK_THREAD_CPUTIME_ID
-  *       Thread-specific CPU-time clock.
-  */
-} clock_e;
-
-/* Datatype
- *  struct interval ->
- *   - name -> string
- *   - start -> struct timespec
- *   - stop -> struct timespec
- */
-typedef struct
-{
-    char * name;
-    struct timespec start;
-    struct timespec stop;
-    struct timespec elapsed;
-    clockid_t clockid;
-    unit_e unit;
-    clock_e clock;
-} interval_t;
+typedef ctimer_unit_e unit_e;
+typedef ctimer_clock_e clock_e;
+typedef ctimer_backend_e backend_e;
+typedef ctimer_tsc_calib_t tsc_calib_t;
+typedef ctimer_tsc_offset_t tsc_offset_t;
+typedef ctimer_tsc_report_t tsc_report_t;
+typedef ctimer_rate_t rate_t;
+typedef ctimer_rate_report_t rate_report_t;
+typedef ctimer_interval_t interval_t;
+typedef ctimer_epoch_pair_t epoch_pair_t;
+typedef ctimer_epoch_t epoch_t;
+typedef ctimer_hist_t hist_t;
+typedef ctimer_wait_stats_t wait_stats_t;
+typedef ctimer_whist_t whist_t;
+typedef ctimer_loadgen_fn loadgen_fn;
+typedef ctimer_loadgen_t loadgen_t;
+typedef ctimer_loadgen_result_t loadgen_result_t;
 
 /** Declarations **/
 
-char * error_num(int status);
-clockid_t set_clock();
-struct timespec diff_timespec(struct timespec a, struct timespec b);
-int set_timespec(struct timespec ** tims, long sec, long nsec);
-char * print_unit(unit_e unit);
-int create_interval(interval_t ** tmp, char * name, clock_e ck, unit_e ut);
-int get_time(clockid_t clock, struct timespec * time);
-int start(interval_t * tmp);
-int stop(interval_t * tmp);
-double elapsed_interval(interval_t * tmp, unit_e ut);
-void print_results(int num, ...);
-void print_results_csv(char * comment, int num, ...);
-
-#if __cplusplus
-}
-#endif
+/* Function-like macros, so that e.g. the `start` and `stop` members of
+ * interval_t are left alone */
+#define error_num(...) ctimer_error_num(__VA_ARGS__)
+#define set_clock(...) ctimer_set_clock(__VA_ARGS__)
+#define diff_timespec(...) ctimer_diff_timespec(__VA_ARGS__)
+#define set_timespec(...) ctimer_set_timespec(__VA_ARGS__)
+#define print_unit(...) ctimer_print_unit(__VA_ARGS__)
+#define create_interval(...) ctimer_create_interval(__VA_ARGS__)
+#define get_time(...) ctimer_get_time(__VA_ARGS__)
+#define get_clock_time(...) ctimer_get_clock_time(__VA_ARGS__)
+#define get_clock_ns(...) ctimer_get_clock_ns(__VA_ARGS__)
+#define set_backend(...) ctimer_set_backend(__VA_ARGS__)
+#define cached_clock_start(...) ctimer_cached_clock_start(__VA_ARGS__)
+#define cached_clock_stop() ctimer_cached_clock_stop()
+#define cached_now_ns() ctimer_cached_now_ns()
+#define read_ticks() ctimer_read_ticks()
+#define calibrate_tsc(...) ctimer_calibrate_tsc(__VA_ARGS__)
+#define get_tsc_calib() ctimer_get_tsc_calib()
+#define ticks_to_ns(...) ctimer_ticks_to_ns(__VA_ARGS__)
+#define epoch_init(...) ctimer_epoch_init(__VA_ARGS__)
+#define epoch_sample(...) ctimer_epoch_sample(__VA_ARGS__)
+#define epoch_to_realtime(...) ctimer_epoch_to_realtime(__VA_ARGS__)
+#define format_utc(...) ctimer_format_utc(__VA_ARGS__)
+#define wait_until(...) ctimer_wait_until(__VA_ARGS__)
+#define wait_for(...) ctimer_wait_for(__VA_ARGS__)
+#define set_wait_spin(...) ctimer_set_wait_spin(__VA_ARGS__)
+#define get_wait_stats() ctimer_get_wait_stats()
+#define print_wait_stats() ctimer_print_wait_stats()
+#define create_rate(...) ctimer_create_rate(__VA_ARGS__)
+#define rate_reset(...) ctimer_rate_reset(__VA_ARGS__)
+#define rate_mark(...) ctimer_rate_mark(__VA_ARGS__)
+#define rate_get(...) ctimer_rate_get(__VA_ARGS__)
+#define print_rate(...) ctimer_print_rate(__VA_ARGS__)
+#define attach_rate(...) ctimer_attach_rate(__VA_ARGS__)
+#define create_hist(...) ctimer_create_hist(__VA_ARGS__)
+#define hist_reset(...) ctimer_hist_reset(__VA_ARGS__)
+#define hist_record(...) ctimer_hist_record(__VA_ARGS__)
+#define hist_merge(...) ctimer_hist_merge(__VA_ARGS__)
+#define hist_percentile(...) ctimer_hist_percentile(__VA_ARGS__)
+#define hist_mean(...) ctimer_hist_mean(__VA_ARGS__)
+#define print_hist(...) ctimer_print_hist(__VA_ARGS__)
+#define hist_record_atomic(...) ctimer_hist_record_atomic(__VA_ARGS__)
+#define create_whist(...) ctimer_create_whist(__VA_ARGS__)
+#define free_whist(...) ctimer_free_whist(__VA_ARGS__)
+#define whist_record(...) ctimer_whist_record(__VA_ARGS__)
+#define whist_get(...) ctimer_whist_get(__VA_ARGS__)
+#define loadgen_run(...) ctimer_loadgen_run(__VA_ARGS__)
+#define print_loadgen(...) ctimer_print_loadgen(__VA_ARGS__)
+#define tsc_check(...) ctimer_tsc_check(__VA_ARGS__)
+#define print_tsc_report(...) ctimer_print_tsc_report(__VA_ARGS__)
+#define start(...) ctimer_start(__VA_ARGS__)
+#define stop(...) ctimer_stop(__VA_ARGS__)
+#define elapsed_interval(...) ctimer_elapsed_interval(__VA_ARGS__)
+#define timespec_to_ns(...) ctimer_timespec_to_ns(__VA_ARGS__)
+#define ns_to_timespec(...) ctimer_ns_to_timespec(__VA_ARGS__)
+#define ns_to_unit_int(...) ctimer_ns_to_unit_int(__VA_ARGS__)
+#define ns_to_unit(...) ctimer_ns_to_unit(__VA_ARGS__)
+#define elapsed_interval_ns(...) ctimer_elapsed_interval_ns(__VA_ARGS__)
+#define elapsed_interval_int(...) ctimer_elapsed_interval_int(__VA_ARGS__)
+#define print_results(...) ctimer_print_results(__VA_ARGS__)
+#define print_results_csv(...) ctimer_print_results_csv(__VA_ARGS__)
 
 #endif
@@ -0,0 +1,61 @@
+/* ***************************************************************************
+ * Internal helpers shared between the translation units of the timer
+ * library. They are not part of the public API and are not exported from
+ * the shared library.
+ */
+#ifndef __TIMER_INTERNAL_HEADER_GUARD__
+#define __TIMER_INTERNAL_HEADER_GUARD__
+
+#include <stdio.h>
+
+#include "ctimer.h"
+
+#if __cplusplus
+extern "C" {
+#endif
+
+/** Macros for verbosity **/
+
+#if TIMERVER > 0
+#define ERROR(message, ...) \
+    fprintf(stderr, \
+            " [ERROR] Timer: (%s:%d) " message "\n" \
+            , __FILE__, __LINE__, ##__VA_ARGS__)
+#else
+#define ERROR(message, ...)
+#endif
+
+#if TIMERVER > 1
+#define DEBUG(message, ...) \
+    fprintf(stderr, \
+            " [DEBUG] Timer: (%s:%d) " message "\n" \
+            , __FILE__, __LINE__, ##__VA_ARGS__)
+#else
+#define DEBUG(message, ...)
+#endif
+
+#define CHECK(cond, message, ...) \
+    if((cond)) { ERROR(message, ##__VA_ARGS__); goto error; }
+
+/* Largest encoding of one trace sample: four 64-bit and three 32-bit
+ * varints, see tracefile.c */
+#define CTIMER_SAMPLE_MAX (4 * 10 + 3 * 5)
+
+/* Index of the oldest sample a thread buffer still holds */
+static inline
+int64_t ctimer_tbuf_first(ctimer_tbuf_t * buf, int64_t count)
+{
+    return count > buf->capacity ? count - buf->capacity : 0;
+}
+
+void ctimer_paired_reading(uint64_t * ticks, int64_t * nsec);
+int ctimer_cached_clock_ensure(void);
+void * ctimer_vdso_sym(const char * name);
+int ctimer_epoch_sample_copy(ctimer_epoch_t * ep, ctimer_epoch_pair_t * copy, int * ncopy);
+int ctimer_trace_write_fd(ctimer_trace_t * t, int fd, uint8_t * out, int64_t since);
+
+#if __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,428 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "timer_internal.h"
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+/** Globals **/
+
+/* Source of trace ids, 0 is never handed out */
+static uint64_t trace_ids = 0;
+
+/* Node of every CPU, read once */
+static int16_t cpu_nodes[CPU_SETSIZE];
+static pthread_once_t cpu_nodes_once = PTHREAD_ONCE_INIT;
+
+/* Buffer of the trace this thread recorded to last */
+static __thread uint64_t local_id = 0;
+static __thread ctimer_tbuf_t * local_buf = NULL;
+static __thread uint32_t local_tid = 0;
+
+/** Functions **/
+
+/* Function
+ *  internal function filling the CPU to node table
+ */
+static
+void read_cpu_nodes(void)
+{
+    for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        cpu_nodes[cpu] = (int16_t) ctimer_cpu_node(cpu);
+}
+
+/* Function
+ *  internal function returning the CPU and node the calling thread runs on
+ */
+static inline
+void current_cpu(uint16_t * cpu, uint16_t * node)
+{
+    int c = sched_getcpu();
+
+    if(c < 0 || c >= CPU_SETSIZE) c = 0;
+    *cpu = (uint16_t) c;
+    *node = (uint16_t) cpu_nodes[c];
+}
+
+/* Function
+ *  internal function mapping anonymous memory backed by huge pages: the
+ *  reserved pool of MAP_HUGETLB first, else a mapping aligned to the huge
+ *  page size that asks for transparent huge pages. Sets the backing that
+ *  was obtained, which is normal pages if neither is available.
+ */
+static
+void * huge_map(size_t bytes, int * pages)
+{
+    size_t align = CTIMER_HUGE_PAGE_BYTES;
+    char * mem = MAP_FAILED;
+    uintptr_t start;
+
+#ifdef MAP_HUGETLB
+    mem = (char *) mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(mem != MAP_FAILED)
+    {
+        *pages = CTIMER_PAGES_HUGETLB;
+        return mem;
+    }
+#endif
+
+    /* Over-map by one huge page and trim to an aligned range */
+    mem = (char *) mmap(NULL, bytes + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mem == MAP_FAILED) return NULL;
+    start = ((uintptr_t) mem + align - 1) & ~(uintptr_t) (align - 1);
+    if(start > (uintptr_t) mem) munmap(mem, start - (uintptr_t) mem);
+    munmap((char *) start + bytes, (uintptr_t) mem + align - start);
+    mem = (char *) start;
+
+    *pages = CTIMER_PAGES_NORMAL;
+#ifdef MADV_HUGEPAGE
+    if(!madvise(mem, bytes, MADV_HUGEPAGE)) *pages = CTIMER_PAGES_THP;
+#endif
+    return mem;
+}
+
+/* Function
+ *  internal function that maps the memory of a thread buffer. On machines
+ *  with several nodes the mapping prefers the given node; either way the
+ *  owning thread touches every page first, so the kernel places it on the
+ *  node that thread runs on.
+ */
+static
+void * tbuf_map(size_t bytes, int node, int nodes, int huge, int * pages)
+{
+    void * mem;
+
+    *pages = CTIMER_PAGES_NORMAL;
+    if(huge) mem = huge_map(bytes, pages);
+    else mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(!mem || mem == MAP_FAILED) return NULL;
+#ifdef SYS_mbind
+    if(nodes > 1 && node < (int) (8 * sizeof(unsigned long)))
+    {
+        unsigned long mask = 1UL << node;
+        if(syscall(SYS_mbind, mem, bytes, MPOL_PREFERRED, &mask, 8 * sizeof(mask), 0))
+        {
+            DEBUG("mbind to node %d failed, relying on first touch", node);
+        }
+    }
+#else
+    (void) node;
+    (void) nodes;
+#endif
+    memset(mem, 0, bytes);
+    return mem;
+}
+
+/* Function
+ *  internal function returning the buffer of the calling thread, which is
+ *  created on first use
+ */
+static
+ctimer_tbuf_t * tbuf_get(ctimer_trace_t * t)
+{
+    ctimer_tbuf_t * buf;
+    uint16_t cpu, node;
+    long page = t->flags & CTIMER_TRACE_HUGE ? CTIMER_HUGE_PAGE_BYTES : sysconf(_SC_PAGESIZE);
+
+    if(local_id == t->id) return local_buf;
+    if(!local_tid) local_tid = (uint32_t) syscall(SYS_gettid);
+
+    /* The thread may have recorded to this trace before another one */
+    for(buf = __atomic_load_n(&t->buffers, __ATOMIC_ACQUIRE); buf; buf = buf->next)
+        if(buf->thread == local_tid) break;
+
+    if(!buf)
+    {
+        current_cpu(&cpu, &node);
+        buf = (ctimer_tbuf_t *) calloc(1, sizeof(ctimer_tbuf_t));
+        CHECK(!buf, "Unable to create trace buffer!");
+        buf->bytes = (t->capacity * sizeof(ctimer_sample_t) + page - 1) / page * page;
+        buf->samples = (ctimer_sample_t *) tbuf_map(buf->bytes, node, t->nodes,
+                                                    t->flags & CTIMER_TRACE_HUGE, &buf->pages);
+        CHECK(!buf->samples, "Unable to map %zu bytes of trace buffer!", buf->bytes);
+        buf->capacity = t->capacity;
+        buf->thread = local_tid;
+        buf->node = node;
+
+        buf->next = __atomic_load_n(&t->buffers, __ATOMIC_RELAXED);
+        while(!__atomic_compare_exchange_n(&t->buffers, &buf->next, buf, 1,
+                                           __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+    local_id = t->id;
+    local_buf = buf;
+    return buf;
+
+error:
+    free(buf);
+    return NULL;
+}
+
+/* Function
+ *  create a trace, which means to allocate the underlying structure. The
+ *  per-thread buffers are allocated when a thread records its first
+ *  sample. With CTIMER_TRACE_HUGE they are backed by huge pages where the
+ *  system provides them, which saves TLB misses on large buffers, and by
+ *  normal pages otherwise. With CTIMER_TRACE_RING a full buffer overwrites
+ *  its oldest samples instead of dropping new ones, the capacity is then
+ *  rounded up to a power of two. Release it with ctimer_free_trace().
+ *
+ *  @param tmp: the address of the trace to be allocated
+ *  @param ck: clock enum of the sample times
+ *  @param capacity: samples per thread buffer
+ *  @param flags: CTIMER_TRACE_* flags
+ *
+ *  @return: status code
+ */
+int ctimer_create_trace(ctimer_trace_t ** tmp, ctimer_clock_e ck, int64_t capacity, int flags)
+{
+    *tmp = NULL;
+    CHECK(capacity <= 0, "Invalid trace capacity %lld", (long long) capacity);
+    *tmp = (ctimer_trace_t *) calloc(1, sizeof(ctimer_trace_t));
+    CHECK(!*tmp, "Unable to create trace!");
+
+    pthread_once(&cpu_nodes_once, read_cpu_nodes);
+    CHECK(ck == CTIMER_TSC && ctimer_calibrate_tsc(CTIMER_TSC_CALIBRATE_MSEC),
+          "Unable to calibrate the tick counter!");
+    if(ck == CTIMER_CACHED) ctimer_cached_clock_ensure();
+
+    /* Rings index with a mask */
+    if(flags & CTIMER_TRACE_RING)
+        while(capacity & (capacity - 1)) capacity += capacity & -capacity;
+
+    (*tmp)->clock = ck;
+    (*tmp)->capacity = capacity;
+    (*tmp)->flags = flags;
+    (*tmp)->id = __atomic_add_fetch(&trace_ids, 1, __ATOMIC_RELAXED);
+    (*tmp)->nodes = ctimer_numa_nodes();
+    if(ck != CTIMER_CPUP && ck != CTIMER_CPUT)
+        CHECK(ctimer_epoch_init(&(*tmp)->epoch, ck), "Unable to map the trace clock to wall time!");
+    return CTIMER_OK;
+
+error:
+    free(*tmp);
+    *tmp = NULL;
+    return CTIMER_NOT_ALLOCATED;
+}
+
+/* Function
+ *  release a trace and all its buffers, no thread may record to it any
+ *  more
+ *
+ *  @param t: the trace
+ */
+void ctimer_free_trace(ctimer_trace_t * t)
+{
+    ctimer_tbuf_t * buf = t->buffers;
+
+    while(buf)
+    {
+        ctimer_tbuf_t * next = buf->next;
+        munmap(buf->samples, buf->bytes);
+        free(buf);
+        buf = next;
+    }
+    for(int i = 0; i < t->nnames; i++)
+        free(t->names[i]);
+    if(local_id == t->id) local_id = 0;
+    free(t);
+}
+
+/* Function
+ *  look up the id of a sample name, adding it to the trace if it is new.
+ *  Look names up once, not for every sample.
+ *
+ *  @param t: the trace
+ *  @param name: the name
+ *
+ *  @return: the name id, or error status if the name table is full
+ */
+int ctimer_trace_name(ctimer_trace_t * t, const char * name)
+{
+    int id;
+
+    while(__atomic_exchange_n(&t->naming, 1, __ATOMIC_ACQUIRE));
+    for(id = 0; id < t->nnames; id++)
+        if(!strcmp(t->names[id], name)) break;
+    if(id == t->nnames)
+    {
+        if(id == CTIMER_TRACE_NAMES || !(t->names[id] = strdup(name))) id = CTIMER_NOT_ALLOCATED;
+        else __atomic_store_n(&t->nnames, id + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&t->naming, 0, __ATOMIC_RELEASE);
+    if(id < 0) ERROR("Unable to add trace name %s", name);
+    return id;
+}
+
+/* Function
+ *  record a sample into the buffer of the calling thread, together with
+ *  the CPU and node it runs on
+ *
+ *  @param t: the trace
+ *  @param name: the name id
+ *  @param start, stop: times of the trace clock in nano-seconds
+ *
+ *  @return: either OK, or CTIMER_NOT_ALLOCATED if the sample was dropped
+ */
+int ctimer_trace_record(ctimer_trace_t * t, int name, int64_t start, int64_t stop)
+{
+    return ctimer_trace_record_span(t, name, 0, 0, start, stop);
+}
+
+/* Function
+ *  hand out a sample id, so that samples recorded before this one can name
+ *  it as their parent. Ids are unique within the trace and never 0.
+ *
+ *  @param t: the trace
+ *
+ *  @return: the id
+ */
+uint32_t ctimer_trace_id(ctimer_trace_t * t)
+{
+    uint32_t id;
+
+    while(!(id = __atomic_add_fetch(&t->ids, 1, __ATOMIC_RELAXED)));
+    return id;
+}
+
+/* Function
+ *  record a sample that is linked to others: its children name its id as
+ *  their parent, on whichever thread they ran. Usually the id is taken
+ *  with ctimer_trace_id() at the start, passed on to the children, and the
+ *  sample is recorded after they are done.
+ *
+ *  @param t: the trace
+ *  @param name: the name id
+ *  @param id: id of the sample, 0 if it has no children
+ *  @param parent: id of the parent sample, 0 if it has none
+ *  @param start, stop: times of the trace clock in nano-seconds
+ *
+ *  @return: either OK, or CTIMER_NOT_ALLOCATED if the sample was dropped
+ */
+int ctimer_trace_record_span(ctimer_trace_t * t, int name, uint32_t id, uint32_t parent, int64_t start, int64_t stop)
+{
+    ctimer_tbuf_t * buf = tbuf_get(t);
+    ctimer_sample_t * s;
+    int64_t i;
+
+    if(!buf) goto drop;
+    i = buf->count;
+    if(i >= buf->capacity)
+    {
+        if(!(t->flags & CTIMER_TRACE_RING)) goto drop;
+        i &= buf->capacity - 1;
+    }
+    s = &buf->samples[i];
+    s->start = start;
+    s->stop = stop;
+    s->name = (uint32_t) name;
+    s->thread = buf->thread;
+    current_cpu(&s->cpu, &s->node);
+    s->id = id;
+    s->parent = parent;
+    __atomic_store_n(&buf->count, buf->count + 1, __ATOMIC_RELEASE);
+    return CTIMER_OK;
+
+drop:
+    __atomic_fetch_add(&t->dropped, 1, __ATOMIC_RELAXED);
+    return CTIMER_NOT_ALLOCATED;
+}
+
+/* Function
+ *  copy the samples all threads of a trace still hold into one array, e.g.
+ *  for ctimer_critical_path(). This must not race with threads recording.
+ *
+ *  @param t: the trace
+ *  @param samples: receives the array, release it with free()
+ *
+ *  @return: the number of samples, or error status
+ */
+int64_t ctimer_trace_collect(ctimer_trace_t * t, ctimer_sample_t ** samples)
+{
+    int64_t n = 0;
+
+    for(ctimer_tbuf_t * buf = t->buffers; buf; buf = buf->next)
+        n += buf->count - ctimer_tbuf_first(buf, buf->count);
+    *samples = (ctimer_sample_t *) malloc((n ? n : 1) * sizeof(ctimer_sample_t));
+    CHECK(!*samples, "Unable to allocate %lld samples", (long long) n);
+
+    n = 0;
+    for(ctimer_tbuf_t * buf = t->buffers; buf; buf = buf->next)
+        for(int64_t i = ctimer_tbuf_first(buf, buf->count); i < buf->count; i++)
+            (*samples)[n++] = buf->samples[i % buf->capacity];
+    return n;
+
+error:
+    return CTIMER_NOT_ALLOCATED;
+}
+
+/* Function
+ *  record the start and stop time of an interval under its name, the
+ *  interval should use the clock of the trace
+ *
+ *  @param t: the trace
+ *  @param iv: the interval
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_trace_interval(ctimer_trace_t * t, ctimer_interval_t * iv)
+{
+    int name = ctimer_trace_name(t, iv->name ? iv->name : "");
+
+    if(name < 0) return name;
+    return ctimer_trace_record(t, name, ctimer_timespec_to_ns(iv->start), ctimer_timespec_to_ns(iv->stop));
+}
+
+/* Function
+ *  print the samples of a trace per name and per NUMA node, this must not
+ *  race with threads recording
+ *
+ *  @param t: the trace
+ *  @param ut: unit enum of the printed durations
+ */
+void ctimer_print_trace(ctimer_trace_t * t, ctimer_unit_e ut)
+{
+    ctimer_hist_t * h;
+    int64_t total = 0;
+    int threads = 0, hugetlb = 0, thp = 0;
+    char label[256];
+
+    for(ctimer_tbuf_t * buf = t->buffers; buf; buf = buf->next)
+    {
+        total += buf->count - ctimer_tbuf_first(buf, buf->count);
+        threads++;
+        hugetlb += buf->pages == CTIMER_PAGES_HUGETLB;
+        thp += buf->pages == CTIMER_PAGES_THP;
+    }
+    printf("Trace: %lld samples from %d threads on %d nodes, %lld dropped\n",
+           (long long) total, threads, t->nodes, (long long) t->dropped);
+    if(t->flags & CTIMER_TRACE_HUGE)
+        printf("Trace: %d buffers on reserved huge pages, %d on transparent huge pages\n", hugetlb, thp);
+    if(ctimer_create_hist(&h) != CTIMER_OK) return;
+
+    for(int name = 0; name < t->nnames; name++)
+    {
+        for(int node = 0; node < t->nodes; node++)
+        {
+            ctimer_hist_reset(h);
+            for(ctimer_tbuf_t * buf = t->buffers; buf; buf = buf->next)
+                for(int64_t i = 0; i < buf->count - ctimer_tbuf_first(buf, buf->count); i++)
+                    if(buf->samples[i].name == (uint32_t) name && buf->samples[i].node == node)
+                        ctimer_hist_record(h, buf->samples[i].stop - buf->samples[i].start);
+            if(h->count == 0) continue;
+            snprintf(label, sizeof(label), "%s (node %d)", t->names[name], node);
+            ctimer_print_hist(h, label, ut);
+        }
+    }
+    free(h);
+}
@@ -0,0 +1,78 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ctimer.h"
+
+/* Analyses a trace file written by ctimer_trace_write() */
+
+static void usage(const char * prog)
+{
+    fprintf(stderr, "Usage: %s [-j threads] [-n slowest] [-u s|ms|us|ns] trace-file\n", prog);
+}
+
+static int parse_unit(const char * s, ctimer_unit_e * ut)
+{
+    static const char * names[] = {"s", "ms", "us", "ns"};
+    static const ctimer_unit_e units[] = {CTIMER_S, CTIMER_MS, CTIMER_US, CTIMER_NS};
+
+    for(int i = 0; i < 4; i++)
+        if(!strcmp(s, names[i]))
+        {
+            *ut = units[i];
+            return 0;
+        }
+    return -1;
+}
+
+int main(int argc, char ** argv)
+{
+    ctimer_trace_file_t * f;
+    ctimer_analysis_t * a;
+    ctimer_interval_t * iv;
+    ctimer_unit_e ut = CTIMER_US;
+    int workers = 0, top = 10, opt;
+
+    while((opt = getopt(argc, argv, "j:n:u:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'j': workers = atoi(optarg); break;
+            case 'n': top = atoi(optarg); break;
+            case 'u':
+                if(parse_unit(optarg, &ut) == 0) break;
+                /* fall through */
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if(optind != argc - 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if(top > CTIMER_ANALYZE_TOP) top = CTIMER_ANALYZE_TOP;
+
+    ctimer_create_interval(&iv, "analyze", CTIMER_MONO, CTIMER_MS);
+    ctimer_start(iv);
+    if(ctimer_open_trace_file(&f, argv[optind]) != CTIMER_OK) return EXIT_FAILURE;
+    if(ctimer_analyze_trace_file(&a, f, workers, top) != CTIMER_OK)
+    {
+        ctimer_close_trace_file(f);
+        return EXIT_FAILURE;
+    }
+    ctimer_stop(iv);
+
+    printf("%s: %zu bytes, %lld blocks, clock %d\n", argv[optind], f->size, (long long) f->nblocks, (int) f->clock);
+    ctimer_print_analysis(a, ut);
+    fprintf(stderr, "Analysed in %.3f ms (%.1f MB/s)\n", ctimer_ns_to_unit(ctimer_elapsed_interval_ns(iv), CTIMER_MS),
+            f->size / ctimer_ns_to_unit(ctimer_elapsed_interval_ns(iv), CTIMER_US));
+
+    ctimer_free_analysis(a);
+    ctimer_close_trace_file(f);
+    free(iv);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,403 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "timer_internal.h"
+
+/* A trace file is a header, the name table, the wall time mapping and a
+ * sequence of blocks:
+ *
+ *   header:  magic, version, clock, nnames       (uint32_t each)
+ *   names:   length (uint32_t) and bytes of every name
+ *   epoch:   npairs (uint32_t), then clock and realtime (int64_t each) of
+ *            every pair                                      (version 3)
+ *   blocks:  ctimer_block_t, then `bytes` bytes of samples
+ *
+ * All fixed-size fields are in host byte order. A block holds up to
+ * CTIMER_TRACE_BLOCK samples of one thread; every sample is encoded as
+ * LEB128 varints:
+ *
+ *   start:  delta of delta to the previous sample of the block, zigzag
+ *   length: stop - start, zigzag
+ *   name, cpu, node
+ *   id:     delta to the previous id of the block, zigzag    (version 2)
+ *   parent: 0 if none, else 1 + zigzag of id - parent        (version 2)
+ *
+ * The first sample refers to the base of the block with a delta of 0, so
+ * every block decodes without the ones before it. Samples of one thread
+ * start at a near constant rate, so the start costs one or two bytes and
+ * a whole sample usually six to eight. */
+
+/** Functions **/
+
+/* Function
+ *  internal function appending an unsigned varint, returns the new end
+ */
+static inline
+uint8_t * put_varint(uint8_t * p, uint64_t v)
+{
+    while(v >= 0x80)
+    {
+        *p++ = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t) v;
+    return p;
+}
+
+/* Function
+ *  internal function reading an unsigned varint, returns NULL if it runs
+ *  past the end
+ */
+static inline
+const uint8_t * get_varint(const uint8_t * p, const uint8_t * end, uint64_t * v)
+{
+    uint64_t x = 0;
+
+    if(p < end && *p < 0x80)
+    {
+        *v = *p;
+        return p + 1;
+    }
+    for(int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        x |= (uint64_t) (*p & 0x7f) << shift;
+        if(!(*p++ & 0x80))
+        {
+            *v = x;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static inline uint64_t zigzag(int64_t v) { return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63); }
+static inline int64_t unzigzag(uint64_t v) { return (int64_t) (v >> 1) ^ -(int64_t) (v & 1); }
+
+/* Function
+ *  internal function encoding up to CTIMER_TRACE_BLOCK samples into a
+ *  block, returns the number of bytes of encoded samples
+ */
+static
+uint32_t encode_block(const ctimer_sample_t * s, int64_t count, uint8_t * out)
+{
+    uint8_t * p = out;
+    int64_t prev = s[0].start, delta = 0;
+    uint32_t id = 0;
+
+    for(int64_t i = 0; i < count; i++)
+    {
+        int64_t d = s[i].start - prev;
+        p = put_varint(p, zigzag(d - delta));
+        p = put_varint(p, zigzag(s[i].stop - s[i].start));
+        p = put_varint(p, s[i].name);
+        p = put_varint(p, s[i].cpu);
+        p = put_varint(p, s[i].node);
+        p = put_varint(p, zigzag((int64_t) s[i].id - id));
+        p = put_varint(p, s[i].parent ? 1 + zigzag((int64_t) s[i].id - s[i].parent) : 0);
+        id = s[i].id;
+        delta = d;
+        prev = s[i].start;
+    }
+    return (uint32_t) (p - out);
+}
+
+/* Function
+ *  internal function writing all of a buffer, retrying after signals
+ */
+static
+int write_all(int fd, const void * data, size_t len)
+{
+    const char * p = (const char *) data;
+
+    while(len > 0)
+    {
+        ssize_t n = write(fd, p, len);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return CTIMER_CALL_FAILED;
+        p += n;
+        len -= (size_t) n;
+    }
+    return CTIMER_OK;
+}
+
+/* Function
+ *  internal function writing the samples of a trace that stopped at or
+ *  after `since` to a file descriptor, encoding the blocks in `out` of
+ *  CTIMER_TRACE_BLOCK * CTIMER_SAMPLE_MAX bytes. It neither allocates nor
+ *  prints, so it is safe in signal handlers. Threads may go on recording
+ *  into rings: blocks they overwrote while being encoded are left out.
+ */
+int ctimer_trace_write_fd(ctimer_trace_t * t, int fd, uint8_t * out, int64_t since)
+{
+    /* Names may be added meanwhile, the header counts the ones written */
+    int nnames = __atomic_load_n(&t->nnames, __ATOMIC_ACQUIRE);
+    uint32_t header[4] = {CTIMER_TRACE_MAGIC, CTIMER_TRACE_VERSION, (uint32_t) t->clock, (uint32_t) nnames};
+    ctimer_epoch_pair_t pairs[CTIMER_EPOCH_SAMPLES];
+    int npairs = 0;
+    uint32_t len;
+
+    if(write_all(fd, header, sizeof(header)) != CTIMER_OK) return CTIMER_CALL_FAILED;
+    for(int i = 0; i < nnames; i++)
+    {
+        len = (uint32_t) strlen(t->names[i]);
+        if(write_all(fd, &len, sizeof(len)) != CTIMER_OK || write_all(fd, t->names[i], len) != CTIMER_OK)
+            return CTIMER_CALL_FAILED;
+    }
+
+    /* Pair the clock with wall time as of now, an empty mapping stays so */
+    if(__atomic_load_n(&t->epoch.count, __ATOMIC_RELAXED)) ctimer_epoch_sample_copy(&t->epoch, pairs, &npairs);
+    len = (uint32_t) npairs;
+    if(write_all(fd, &len, sizeof(len)) != CTIMER_OK ||
+       write_all(fd, pairs, (size_t) npairs * sizeof(ctimer_epoch_pair_t)) != CTIMER_OK)
+        return CTIMER_CALL_FAILED;
+
+    for(ctimer_tbuf_t * buf = __atomic_load_n(&t->buffers, __ATOMIC_ACQUIRE); buf; buf = buf->next)
+    {
+        int64_t count = __atomic_load_n(&buf->count, __ATOMIC_ACQUIRE);
+        int64_t i = ctimer_tbuf_first(buf, count);
+
+        /* The oldest sample of a full ring may be being overwritten */
+        if(i > 0) i++;
+        /* Samples are recorded when they stop, so the old ones come first */
+        while(i < count && buf->samples[i % buf->capacity].stop < since) i++;
+        while(i < count)
+        {
+            ctimer_block_t block;
+            int64_t at = i % buf->capacity;
+            int64_t n = count - i < CTIMER_TRACE_BLOCK ? count - i : CTIMER_TRACE_BLOCK;
+
+            if(n > buf->capacity - at) n = buf->capacity - at;
+            block.magic = CTIMER_BLOCK_MAGIC;
+            block.thread = buf->thread;
+            block.count = (uint32_t) n;
+            block.base = buf->samples[at].start;
+            block.bytes = encode_block(&buf->samples[at], n, out);
+            if((!(t->flags & CTIMER_TRACE_RING) || i > __atomic_load_n(&buf->count, __ATOMIC_ACQUIRE) - buf->capacity) &&
+               (write_all(fd, &block, sizeof(block)) != CTIMER_OK || write_all(fd, out, block.bytes) != CTIMER_OK))
+                return CTIMER_CALL_FAILED;
+            i += n;
+        }
+    }
+    return CTIMER_OK;
+}
+
+/* Function
+ *  write the samples of a trace to a file in the compact block encoding,
+ *  see the top of tracefile.c. This must not race with threads recording,
+ *  except into rings.
+ *
+ *  @param t: the trace
+ *  @param path: the file, which is replaced
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_trace_write(ctimer_trace_t * t, const char * path)
+{
+    uint8_t * out = NULL;
+    int fd = -1;
+    int ret = CTIMER_NOT_ALLOCATED;
+
+    out = (uint8_t *) malloc((size_t) CTIMER_TRACE_BLOCK * CTIMER_SAMPLE_MAX);
+    CHECK(!out, "Unable to allocate trace block!");
+    ret = CTIMER_CALL_FAILED;
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd < 0, "Unable to open %s", path);
+    CHECK(ctimer_trace_write_fd(t, fd, out, INT64_MIN) != CTIMER_OK, "Unable to write %s", path);
+    CHECK(close(fd), "Unable to write %s", path);
+    free(out);
+    return CTIMER_OK;
+
+error:
+    if(fd >= 0) close(fd);
+    free(out);
+    return ret;
+}
+
+/* Function
+ *  open a trace file written by ctimer_trace_write(), which means to map
+ *  it into memory, read the name table and find the blocks. Release it
+ *  with ctimer_close_trace_file().
+ *
+ *  @param tmp: the address of the trace file to be allocated
+ *  @param path: the file
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_open_trace_file(ctimer_trace_file_t ** tmp, const char * path)
+{
+    ctimer_trace_file_t * f;
+    uint32_t header[4];
+    struct stat st;
+    size_t off, cap = 0;
+    int fd;
+
+    *tmp = f = (ctimer_trace_file_t *) calloc(1, sizeof(ctimer_trace_file_t));
+    CHECK(!f, "Unable to create trace file!");
+    fd = open(path, O_RDONLY);
+    CHECK(fd < 0, "Unable to open %s", path);
+    if(fstat(fd, &st) || st.st_size < (off_t) sizeof(header))
+    {
+        close(fd);
+        CHECK(1, "%s is no trace file", path);
+    }
+    f->size = (size_t) st.st_size;
+    f->data = (const uint8_t *) mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(f->data == MAP_FAILED)
+    {
+        f->data = NULL;
+        CHECK(1, "Unable to map %s", path);
+    }
+    madvise((void *) f->data, f->size, MADV_WILLNEED);
+
+    memcpy(header, f->data, sizeof(header));
+    CHECK(header[0] != CTIMER_TRACE_MAGIC, "%s is no trace file", path);
+    CHECK(header[1] < 1 || header[1] > CTIMER_TRACE_VERSION, "%s has unknown version %u", path, header[1]);
+    f->version = header[1];
+    CHECK(header[3] > CTIMER_TRACE_NAMES, "%s has too many names", path);
+    f->clock = (ctimer_clock_e) header[2];
+    off = sizeof(header);
+    for(uint32_t i = 0; i < header[3]; i++)
+    {
+        uint32_t len;
+        CHECK(off + sizeof(len) > f->size, "%s is truncated", path);
+        memcpy(&len, f->data + off, sizeof(len));
+        off += sizeof(len);
+        CHECK(len > f->size - off, "%s is truncated", path);
+        f->names[i] = strndup((const char *) f->data + off, len);
+        CHECK(!f->names[i], "Unable to read the names of %s", path);
+        f->nnames++;
+        off += len;
+    }
+    f->epoch.clock = f->clock;
+    if(f->version >= 3)
+    {
+        uint32_t npairs;
+        CHECK(off + sizeof(npairs) > f->size, "%s is truncated", path);
+        memcpy(&npairs, f->data + off, sizeof(npairs));
+        off += sizeof(npairs);
+        CHECK(npairs > CTIMER_EPOCH_SAMPLES, "%s has too many wall time pairs", path);
+        CHECK(npairs * sizeof(ctimer_epoch_pair_t) > f->size - off, "%s is truncated", path);
+        memcpy(f->epoch.pairs, f->data + off, npairs * sizeof(ctimer_epoch_pair_t));
+        f->epoch.count = (int) npairs;
+        off += npairs * sizeof(ctimer_epoch_pair_t);
+    }
+
+    /* Block headers tell where the next block starts */
+    while(off < f->size)
+    {
+        ctimer_block_t block;
+        CHECK(off + sizeof(block) > f->size, "%s is truncated", path);
+        memcpy(&block, f->data + off, sizeof(block));
+        CHECK(block.magic != CTIMER_BLOCK_MAGIC, "%s has a broken block at %zu", path, off);
+        CHECK(block.bytes > f->size - off - sizeof(block), "%s is truncated", path);
+        if(f->nblocks == (int64_t) cap)
+        {
+            size_t * blocks = (size_t *) realloc(f->blocks, (cap ? 2 * cap : 64) * sizeof(size_t));
+            CHECK(!blocks, "Unable to index the blocks of %s", path);
+            f->blocks = blocks;
+            cap = cap ? 2 * cap : 64;
+        }
+        f->blocks[f->nblocks++] = off;
+        f->samples += block.count;
+        off += sizeof(block) + block.bytes;
+    }
+    return CTIMER_OK;
+
+error:
+    if(f) ctimer_close_trace_file(f);
+    *tmp = NULL;
+    return CTIMER_CALL_FAILED;
+}
+
+/* Function
+ *  release a trace file
+ *
+ *  @param f: the trace file
+ */
+void ctimer_close_trace_file(ctimer_trace_file_t * f)
+{
+    if(f->data) munmap((void *) f->data, f->size);
+    for(int i = 0; i < f->nnames; i++)
+        free(f->names[i]);
+    free(f->blocks);
+    free(f);
+}
+
+/* Function
+ *  start decoding a block of a trace file, the samples are then taken one
+ *  by one with ctimer_decode_next(). Blocks are independent, so several
+ *  threads may decode different blocks at the same time.
+ *
+ *  @param d: the decoder
+ *  @param f: the trace file
+ *  @param block: index of the block
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_decode_block(ctimer_decoder_t * d, ctimer_trace_file_t * f, int64_t block)
+{
+    ctimer_block_t header;
+
+    CHECK(block < 0 || block >= f->nblocks, "Invalid block %lld", (long long) block);
+    memcpy(&header, f->data + f->blocks[block], sizeof(header));
+    d->p = f->data + f->blocks[block] + sizeof(header);
+    d->end = d->p + header.bytes;
+    d->left = header.count;
+    d->prev = header.base;
+    d->delta = 0;
+    d->id = 0;
+    d->thread = header.thread;
+    d->version = f->version;
+    return CTIMER_OK;
+
+error:
+    return CTIMER_CALL_FAILED;
+}
+
+/* Function
+ *  decode the next sample of a block
+ *
+ *  @param d: the decoder
+ *  @param s: receives the sample
+ *
+ *  @return: 1 if a sample was decoded, 0 at the end of the block, or error
+ *           status if the block is broken
+ */
+int ctimer_decode_next(ctimer_decoder_t * d, ctimer_sample_t * s)
+{
+    uint64_t dod, len, name, cpu, node, id = 0, parent = 0;
+    const uint8_t * p = d->p;
+
+    if(d->left == 0) return 0;
+    if(!(p = get_varint(p, d->end, &dod)) || !(p = get_varint(p, d->end, &len)) ||
+       !(p = get_varint(p, d->end, &name)) || !(p = get_varint(p, d->end, &cpu)) ||
+       !(p = get_varint(p, d->end, &node)) ||
+       (d->version >= 2 && (!(p = get_varint(p, d->end, &id)) || !(p = get_varint(p, d->end, &parent)))))
+    {
+        ERROR("Broken trace block");
+        return CTIMER_CALL_FAILED;
+    }
+    d->delta += unzigzag(dod);
+    d->prev += d->delta;
+    s->start = d->prev;
+    s->stop = d->prev + unzigzag(len);
+    s->name = (uint32_t) name;
+    s->thread = d->thread;
+    s->cpu = (uint16_t) cpu;
+    s->node = (uint16_t) node;
+    d->id += (uint32_t) unzigzag(id);
+    s->id = d->id;
+    s->parent = parent ? d->id - (uint32_t) unzigzag(parent - 1) : 0;
+    s->reserved = 0;
+    d->p = p;
+    d->left--;
+    return 1;
+}
@@ -0,0 +1,343 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "timer_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+/** Types **/
+
+/* Shared state of one ping-pong measurement, the sequence number lives on
+ * its own cache line so that only it bounces between the two CPUs. */
+typedef struct
+{
+    volatile uint64_t seq __attribute__((aligned(64)));
+    volatile uint64_t stamp;
+    volatile int abort;
+    int unpinned;
+    int rounds;
+    int cpu[2];
+    int64_t lower;
+    int64_t upper;
+} pingpong_t;
+
+/* Paired (ticks, CLOCK_MONOTONIC_RAW) reading */
+typedef struct
+{
+    uint64_t ticks;
+    int64_t nsec;
+} reading_t;
+
+/** Globals **/
+
+/* Readings of the drift over time, the first one taken at calibration.
+ * When full, every other reading is dropped, which keeps the span. */
+static reading_t readings[CTIMER_TSC_READINGS];
+static int nreadings = 0;
+static pthread_mutex_t readings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Functions **/
+
+/* Function
+ *  internal function that reads the tick counter without it being
+ *  reordered against the surrounding loads and stores.
+ */
+static inline
+uint64_t fenced_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int aux;
+    uint64_t ticks = __rdtscp(&aux);
+    _mm_lfence();
+    return ticks;
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return ctimer_read_ticks();
+#endif
+}
+
+/* Function
+ *  internal function that checks whether the CPU advertises a tick counter
+ *  that runs at a constant rate in all power states.
+ */
+static
+int invariant_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int a, b, c, d;
+    if(!__get_cpuid(0x80000007, &a, &b, &c, &d)) return 0;
+    return (d >> 8) & 1;
+#else
+    /* The AArch64 generic timer is specified to be constant rate, other
+     * architectures use CLOCK_MONOTONIC_RAW. */
+    return 1;
+#endif
+}
+
+/* Function
+ *  internal function that pins the calling thread to a single CPU
+ */
+static
+int pin_thread(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* Function
+ *  internal thread on the reference CPU. Every round it stamps the time,
+ *  hands the cache line to the remote CPU and stamps the time again once
+ *  the remote stamp has come back. With d the remote offset:
+ *      before + d <= remote <= after + d
+ */
+static
+void * pingpong_ref(void * arg)
+{
+    pingpong_t * pp = (pingpong_t *) arg;
+    uint64_t before, after, remote;
+
+    if(pin_thread(pp->cpu[0])) pp->unpinned = 1;
+
+    pp->lower = INT64_MIN;
+    pp->upper = INT64_MAX;
+    for(uint64_t r = 1; r <= (uint64_t) pp->rounds; r++)
+    {
+        before = fenced_ticks();
+        __atomic_store_n(&pp->seq, 2 * r - 1, __ATOMIC_RELEASE);
+        while(__atomic_load_n(&pp->seq, __ATOMIC_ACQUIRE) != 2 * r);
+        after = fenced_ticks();
+        remote = pp->stamp;
+
+        if((int64_t) (remote - after) > pp->lower) pp->lower = remote - after;
+        if((int64_t) (remote - before) < pp->upper) pp->upper = remote - before;
+    }
+    return NULL;
+}
+
+/* Function
+ *  internal thread on the remote CPU, answers each ping with its own stamp
+ */
+static
+void * pingpong_remote(void * arg)
+{
+    pingpong_t * pp = (pingpong_t *) arg;
+
+    if(pin_thread(pp->cpu[1])) pp->unpinned = 1;
+
+    for(uint64_t r = 1; r <= (uint64_t) pp->rounds; r++)
+    {
+        while(__atomic_load_n(&pp->seq, __ATOMIC_ACQUIRE) != 2 * r - 1)
+            if(pp->abort) return NULL;
+        pp->stamp = fenced_ticks();
+        __atomic_store_n(&pp->seq, 2 * r, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+/* Function
+ *  internal function that measures the offset of one CPU against the
+ *  reference CPU using cache-line ping-pong between two pinned threads.
+ */
+static
+int measure_offset(int ref, int cpu, int rounds, ctimer_tsc_offset_t * off)
+{
+    pingpong_t * pp;
+    pthread_t threads[2];
+
+    CHECK(posix_memalign((void **) &pp, 64, sizeof(pingpong_t)),
+          "Unable to allocate ping-pong state!");
+    memset(pp, 0, sizeof(pingpong_t));
+    pp->rounds = rounds;
+    pp->cpu[0] = ref;
+    pp->cpu[1] = cpu;
+
+    CHECK(pthread_create(&threads[1], NULL, pingpong_remote, pp),
+          "Unable to start thread for CPU %d", cpu);
+    if(pthread_create(&threads[0], NULL, pingpong_ref, pp))
+    {
+        ERROR("Unable to start thread for CPU %d", ref);
+        pp->abort = 1;
+        pthread_join(threads[1], NULL);
+        free(pp);
+        return CTIMER_CLOCK_FAILED;
+    }
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+
+    if(pp->unpinned)
+    {
+        ERROR("Unable to pin threads to CPUs %d and %d", ref, cpu);
+        free(pp);
+        return CTIMER_CLOCK_FAILED;
+    }
+
+    off->cpu = cpu;
+    off->consistent = pp->lower <= pp->upper;
+    off->offset = pp->lower / 2 + pp->upper / 2;
+    off->error = off->consistent ? (pp->upper - pp->lower) / 2 : 0;
+    free(pp);
+    return CTIMER_OK;
+
+error:
+    return CTIMER_NOT_ALLOCATED;
+}
+
+/* Function
+ *  internal function adding a paired reading to the kept ones and fitting
+ *  the drift, the offset of the `tsc` clock from CLOCK_MONOTONIC_RAW, over
+ *  them by least squares
+ */
+static
+void measure_drift(ctimer_tsc_calib_t * calib, ctimer_tsc_report_t * rep)
+{
+    double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0, slope;
+    int64_t x0;
+    int n;
+
+    pthread_mutex_lock(&readings_lock);
+    if(!nreadings)
+    {
+        readings[0].ticks = calib->ref_ticks;
+        readings[0].nsec = calib->ref_ns;
+        nreadings = 1;
+    }
+    if(nreadings == CTIMER_TSC_READINGS)
+    {
+        for(int i = 1; i < CTIMER_TSC_READINGS / 2; i++)
+            readings[i] = readings[2 * i];
+        nreadings = CTIMER_TSC_READINGS / 2;
+    }
+    ctimer_paired_reading(&readings[nreadings].ticks, &readings[nreadings].nsec);
+    n = ++nreadings;
+
+    x0 = readings[0].nsec;
+    for(int i = 0; i < n; i++)
+    {
+        double x = (double) (readings[i].nsec - x0);
+        double y = (double) (ctimer_ticks_to_ns(readings[i].ticks) - readings[i].nsec);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    rep->drift_readings = n;
+    rep->drift_period_ns = readings[n - 1].nsec - x0;
+    pthread_mutex_unlock(&readings_lock);
+
+    if(rep->drift_period_ns <= 0) return;
+    slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    rep->drift_ppm = slope * 1e6;
+    rep->drift_ns = (int64_t) (slope * rep->drift_period_ns);
+}
+
+/* Function
+ *  check whether the tick counter is trustworthy: it needs to be invariant,
+ *  synchronised across all CPUs this process may run on and must not drift
+ *  from CLOCK_MONOTONIC_RAW. Every check keeps a paired reading, the drift
+ *  is the slope fitted over them and judged once they span at least
+ *  CTIMER_TSC_DRIFT_MIN_NS, so run the check periodically. If the check
+ *  fails the `tsc` clock is disabled and falls back to CLOCK_MONOTONIC_RAW.
+ *
+ *  Each CPU is compared to the first CPU of the affinity mask, pinned
+ *  threads bounce a cache line `rounds` times to bound the offset.
+ *
+ *  @param rep: the report to be filled in
+ *  @param rounds: number of ping-pong round trips per CPU
+ *
+ *  @return: either OK, or error status
+ */
+int ctimer_tsc_check(ctimer_tsc_report_t * rep, int rounds)
+{
+    ctimer_tsc_calib_t * calib = ctimer_get_tsc_calib();
+    cpu_set_t set;
+    int ref = -1;
+    int ret;
+
+    CHECK(!rep, "No report given!");
+    CHECK(rounds <= 0, "Invalid number of rounds %d", rounds);
+    memset(rep, 0, sizeof(ctimer_tsc_report_t));
+
+    ret = ctimer_calibrate_tsc(CTIMER_TSC_CALIBRATE_MSEC);
+    if(ret != CTIMER_OK) return ret;
+
+    rep->invariant = invariant_ticks();
+
+    CHECK(sched_getaffinity(0, sizeof(set), &set), "Unable to get CPU affinity!");
+    for(int cpu = 0; cpu < CPU_SETSIZE && rep->ncpus < CTIMER_TSC_MAX_CPUS; cpu++)
+    {
+        if(!CPU_ISSET(cpu, &set)) continue;
+        ctimer_tsc_offset_t * off = &rep->offsets[rep->ncpus++];
+        if(ref < 0)
+        {
+            ref = cpu;
+            off->cpu = cpu;
+            off->consistent = 1;
+            continue;
+        }
+        ret = measure_offset(ref, cpu, rounds, off);
+        if(ret != CTIMER_OK) return ret;
+
+        int64_t skew = ctimer_ticks_to_ns(calib->ref_ticks + llabs(off->offset)) - calib->ref_ns;
+        if(skew > rep->max_skew_ns) rep->max_skew_ns = skew;
+    }
+
+    /* The drift is only judged once the readings span long enough */
+    measure_drift(calib, rep);
+    rep->healthy = rep->invariant && rep->max_skew_ns <= CTIMER_TSC_SKEW_LIMIT_NS;
+    if(rep->drift_period_ns >= CTIMER_TSC_DRIFT_MIN_NS)
+        rep->healthy = rep->healthy
+            && rep->drift_ppm <= CTIMER_TSC_DRIFT_LIMIT_PPM
+            && rep->drift_ppm >= -CTIMER_TSC_DRIFT_LIMIT_PPM;
+    for(int i = 0; i < rep->ncpus; i++)
+        rep->healthy = rep->healthy && rep->offsets[i].consistent;
+
+    if(!rep->healthy && __atomic_load_n(&calib->healthy, __ATOMIC_ACQUIRE))
+        ERROR("Tick counter unreliable, tsc clock uses CLOCK_MONOTONIC_RAW");
+    __atomic_store_n(&calib->healthy, rep->healthy, __ATOMIC_RELEASE);
+    return CTIMER_OK;
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  print the measurements of a ctimer_tsc_check() run
+ *
+ *  @param rep: the report
+ */
+void ctimer_print_tsc_report(ctimer_tsc_report_t * rep)
+{
+    ctimer_tsc_calib_t * calib = ctimer_get_tsc_calib();
+
+    printf("TSC frequency: %llu Hz (mult %llu, shift %u)\n",
+           (unsigned long long) calib->freq, (unsigned long long) calib->mult,
+           calib->shift);
+    printf("TSC invariant: %s\n", rep->invariant ? "yes" : "no");
+    if(rep->drift_period_ns >= CTIMER_TSC_DRIFT_MIN_NS)
+        printf("TSC drift: %.3f ppm, %lld ns over %.3f s (%d readings)\n", rep->drift_ppm,
+               (long long) rep->drift_ns, CTIMER_NANO_TO_SEC((double) rep->drift_period_ns),
+               rep->drift_readings);
+    else
+        printf("TSC drift: not judged yet, readings span %.3f s\n",
+               CTIMER_NANO_TO_SEC((double) rep->drift_period_ns));
+    printf("TSC max skew: %lld ns over %d CPUs\n",
+           (long long) rep->max_skew_ns, rep->ncpus);
+    for(int i = 0; i < rep->ncpus; i++)
+    {
+        ctimer_tsc_offset_t * off = &rep->offsets[i];
+        printf(" CPU %d: offset %lld +/- %lld ticks%s\n", off->cpu,
+               (long long) off->offset, (long long) off->error,
+               off->consistent ? "" : " (NOT MONOTONIC)");
+    }
+    printf("TSC healthy: %s\n", rep->healthy ? "yes" : "no");
+}
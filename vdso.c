@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <elf.h>
+#include <link.h>
+#include <sys/auxv.h>
+
+#include "timer_internal.h"
+
+/** Functions **/
+
+/* Function
+ *  internal function that counts the symbols of a DT_GNU_HASH table, which
+ *  unlike DT_HASH does not store the count directly.
+ */
+static
+uint32_t gnu_hash_count(const uint32_t * hash)
+{
+    uint32_t nbuckets = hash[0];
+    uint32_t symoffset = hash[1];
+    uint32_t bloom_size = hash[2];
+    const uint32_t * buckets = hash + 4 + bloom_size * (sizeof(ElfW(Addr)) / 4);
+    const uint32_t * chain = buckets + nbuckets;
+    uint32_t last = 0;
+
+    for(uint32_t i = 0; i < nbuckets; i++)
+        if(buckets[i] > last) last = buckets[i];
+    if(last < symoffset) return symoffset;
+
+    /* The chain of the last bucket ends with an odd entry */
+    while(!(chain[last - symoffset] & 1)) last++;
+    return last + 1;
+}
+
+/* Function
+ *  look up a symbol in the vDSO that the kernel maps into every process,
+ *  by walking its dynamic symbol table.
+ *
+ *  @param name: the symbol name
+ *
+ *  @return: the address of the symbol, or NULL if not found
+ */
+void * ctimer_vdso_sym(const char * name)
+{
+    ElfW(Ehdr) * ehdr = (ElfW(Ehdr) *) getauxval(AT_SYSINFO_EHDR);
+    ElfW(Phdr) * phdr;
+    ElfW(Dyn) * dyn = NULL;
+    ElfW(Sym) * symtab = NULL;
+    const char * strtab = NULL;
+    const uint32_t * hash = NULL;
+    const uint32_t * gnu_hash = NULL;
+    uintptr_t base = (uintptr_t) ehdr;
+    uintptr_t offset = 0;
+    int has_load = 0;
+    uint32_t count;
+
+    CHECK(!ehdr, "No vDSO mapped into this process!");
+    CHECK(memcmp(ehdr->e_ident, ELFMAG, SELFMAG), "vDSO is not an ELF image!");
+
+    phdr = (ElfW(Phdr) *) (base + ehdr->e_phoff);
+    for(int i = 0; i < ehdr->e_phnum; i++)
+    {
+        if(phdr[i].p_type == PT_LOAD && !has_load)
+        {
+            offset = base + phdr[i].p_offset - phdr[i].p_vaddr;
+            has_load = 1;
+        }
+        else if(phdr[i].p_type == PT_DYNAMIC)
+        {
+            dyn = (ElfW(Dyn) *) (base + phdr[i].p_offset);
+        }
+    }
+    CHECK(!has_load || !dyn, "vDSO has no dynamic section!");
+
+    for(; dyn->d_tag != DT_NULL; dyn++)
+    {
+        switch(dyn->d_tag)
+        {
+            case DT_SYMTAB:
+                symtab = (ElfW(Sym) *) (offset + dyn->d_un.d_ptr);
+                break;
+            case DT_STRTAB:
+                strtab = (const char *) (offset + dyn->d_un.d_ptr);
+                break;
+            case DT_HASH:
+                hash = (const uint32_t *) (offset + dyn->d_un.d_ptr);
+                break;
+            case DT_GNU_HASH:
+                gnu_hash = (const uint32_t *) (offset + dyn->d_un.d_ptr);
+                break;
+        }
+    }
+    CHECK(!symtab || !strtab || (!hash && !gnu_hash), "vDSO has no symbol table!");
+
+    count = hash ? hash[1] : gnu_hash_count(gnu_hash);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        ElfW(Sym) * sym = &symtab[i];
+        if(ELF64_ST_TYPE(sym->st_info) != STT_FUNC) continue;
+        if(sym->st_shndx == SHN_UNDEF) continue;
+        if(strcmp(strtab + sym->st_name, name)) continue;
+        return (void *) (offset + sym->st_value);
+    }
+    DEBUG("Symbol %s not found in vDSO", name);
+    return NULL;
+
+error:
+    return NULL;
+}
@@ -0,0 +1,140 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#include "timer_internal.h"
+
+/** Globals **/
+
+static int64_t wait_spin = CTIMER_WAIT_SPIN_NS;
+static __thread ctimer_wait_stats_t wait_stats;
+static __thread int64_t wake_avg = 0;
+
+/** Functions **/
+
+/* Function
+ *  internal function that sleeps until `deadline` of the given clock. Clocks
+ *  that clock_nanosleep() supports sleep on an absolute deadline, the others
+ *  sleep relative on CLOCK_MONOTONIC.
+ *
+ *  @return: 0 if no sleep was possible, 1 otherwise
+ */
+static
+int sleep_until(ctimer_clock_e ck, int64_t deadline, int64_t now)
+{
+    struct timespec time;
+
+    switch(ck)
+    {
+        case CTIMER_RT:
+        case CTIMER_MONO:
+        case CTIMER_MONOB:
+            time = ctimer_ns_to_timespec(deadline);
+            while(clock_nanosleep(ctimer_set_clock(ck), TIMER_ABSTIME, &time, NULL) == EINTR);
+            return 1;
+        case CTIMER_CPUP:
+        case CTIMER_CPUT:
+            /* CPU time does not advance while sleeping */
+            return 0;
+        default:
+            time = ctimer_ns_to_timespec(deadline - now);
+            clock_nanosleep(CLOCK_MONOTONIC, 0, &time, NULL);
+            return 1;
+    }
+}
+
+/* Function
+ *  wait until the given clock reaches target. The thread sleeps until the
+ *  spin time before the target and then spins on the clock, which avoids
+ *  the 50+ us wake-up latency of a plain sleep. The spin time is the larger
+ *  of ctimer_set_wait_spin() and twice the average wake-up latency seen by this
+ *  thread. The overshoot is recorded in the thread's wait statistics.
+ *
+ *  @param ck: clock enum
+ *  @param target: the target time in nano-seconds
+ *
+ *  @return: either OK, or CTIMER_CLOCK_FAILED
+ */
+int ctimer_wait_until(ctimer_clock_e ck, int64_t target)
+{
+    int64_t now = ctimer_get_clock_ns(ck);
+    int64_t spin = 2 * wake_avg > wait_spin ? 2 * wake_avg : wait_spin;
+    int64_t deadline = target - spin;
+
+    CHECK(!now, "Unable to read clock for waiting!");
+    if(now < deadline && sleep_until(ck, deadline, now))
+    {
+        int64_t wake = ctimer_get_clock_ns(ck) - deadline;
+        wake_avg = wait_stats.sleeps ? wake_avg + (wake - wake_avg) / 8 : wake;
+        wait_stats.sleeps++;
+        wait_stats.wake_total += wake;
+        if(wake > wait_stats.wake_max) wait_stats.wake_max = wake;
+    }
+    while((now = ctimer_get_clock_ns(ck)) < target);
+
+    wait_stats.count++;
+    wait_stats.total += now - target;
+    if(now - target > wait_stats.max) wait_stats.max = now - target;
+    return CTIMER_OK;
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  wait for the given time on a clock, see ctimer_wait_until()
+ *
+ *  @param ck: clock enum
+ *  @param nsec: the time to wait in nano-seconds
+ *
+ *  @return: either OK, or CTIMER_CLOCK_FAILED
+ */
+int ctimer_wait_for(ctimer_clock_e ck, int64_t nsec)
+{
+    int64_t now = ctimer_get_clock_ns(ck);
+    CHECK(!now, "Unable to read clock for waiting!");
+    return ctimer_wait_until(ck, now + nsec);
+
+error:
+    return CTIMER_CLOCK_FAILED;
+}
+
+/* Function
+ *  set the minimum time before a wait target at which waiting switches
+ *  from sleeping to spinning. Larger values cost CPU time, smaller ones
+ *  risk oversleeping; the wake_max of the wait statistics shows what is
+ *  needed.
+ *
+ *  @param nsec: the spin time in nano-seconds
+ */
+void ctimer_set_wait_spin(int64_t nsec)
+{
+    wait_spin = nsec < 0 ? 0 : nsec;
+}
+
+/* Function
+ *  access the wait statistics of the calling thread
+ *
+ *  @return: pointer to the statistics
+ */
+ctimer_wait_stats_t * ctimer_get_wait_stats(void)
+{
+    return &wait_stats;
+}
+
+/* Function
+ *  print the wait statistics of the calling thread
+ */
+void ctimer_print_wait_stats(void)
+{
+    printf("Waits: %lld, overshoot mean %.3f us, max %.3f us\n",
+           (long long) wait_stats.count,
+           wait_stats.count ? ctimer_ns_to_unit(wait_stats.total / wait_stats.count, CTIMER_US) : 0.0,
+           ctimer_ns_to_unit(wait_stats.max, CTIMER_US));
+    printf("Sleeps: %lld, wake-up late mean %.3f us, max %.3f us (spin >= %.3f us)\n",
+           (long long) wait_stats.sleeps,
+           wait_stats.sleeps ? ctimer_ns_to_unit(wait_stats.wake_total / wait_stats.sleeps, CTIMER_US) : 0.0,
+           ctimer_ns_to_unit(wait_stats.wake_max, CTIMER_US), ctimer_ns_to_unit(wait_spin, CTIMER_US));
+}